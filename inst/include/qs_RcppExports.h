@@ -324,16 +324,16 @@ namespace qs {
         return Rcpp::as<bool >(rcpp_result_gen);
     }
 
-    inline double qsave(SEXP const x, const std::string& file, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15L, const bool check_hash = true, const int nthreads = 1) {
-        typedef SEXP(*Ptr_qsave)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
+    inline double qsave(SEXP const x, const std::string& file, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15L, const bool check_hash = true, const int nthreads = 1, const int block_size = 524288, const bool block_hash = false, const bool string_dedup = false, const bool block_index = false, const bool raw_blocks = false, const bool string_dict = false, const bool string_columnar = false) {
+        typedef SEXP(*Ptr_qsave)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
         static Ptr_qsave p_qsave = NULL;
         if (p_qsave == NULL) {
-            validateSignature("double(*qsave)(SEXP const,const std::string&,const std::string,const std::string,const int,const int,const bool,const int)");
+            validateSignature("double(*qsave)(SEXP const,const std::string&,const std::string,const std::string,const int,const int,const bool,const int,const int,const bool,const bool,const bool,const bool,const bool,const bool)");
             p_qsave = (Ptr_qsave)R_GetCCallable("qs", "_qs_qsave");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qsave(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)), Shield<SEXP>(Rcpp::wrap(nthreads)));
+            rcpp_result_gen = p_qsave(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)), Shield<SEXP>(Rcpp::wrap(nthreads)), Shield<SEXP>(Rcpp::wrap(block_size)), Shield<SEXP>(Rcpp::wrap(block_hash)), Shield<SEXP>(Rcpp::wrap(string_dedup)), Shield<SEXP>(Rcpp::wrap(block_index)), Shield<SEXP>(Rcpp::wrap(raw_blocks)), Shield<SEXP>(Rcpp::wrap(string_dict)), Shield<SEXP>(Rcpp::wrap(string_columnar)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -364,16 +364,16 @@ namespace qs {
         return Rcpp::as<double >(rcpp_result_gen);
     }
 
-    inline double qsave_fd(SEXP const x, const int fd, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15, const bool check_hash = true) {
-        typedef SEXP(*Ptr_qsave_fd)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
+    inline double qsave_fd(SEXP const x, const int fd, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15, const bool check_hash = true, const int nthreads = 1, const int block_size = 524288, const bool block_hash = false, const bool string_dedup = false, const bool block_index = false, const bool raw_blocks = false, const bool string_dict = false, const bool string_columnar = false) {
+        typedef SEXP(*Ptr_qsave_fd)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
         static Ptr_qsave_fd p_qsave_fd = NULL;
         if (p_qsave_fd == NULL) {
-            validateSignature("double(*qsave_fd)(SEXP const,const int,const std::string,const std::string,const int,const int,const bool)");
+            validateSignature("double(*qsave_fd)(SEXP const,const int,const std::string,const std::string,const int,const int,const bool,const int,const int,const bool,const bool,const bool,const bool,const bool,const bool)");
             p_qsave_fd = (Ptr_qsave_fd)R_GetCCallable("qs", "_qs_qsave_fd");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qsave_fd(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(fd)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)));
+            rcpp_result_gen = p_qsave_fd(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(fd)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)), Shield<SEXP>(Rcpp::wrap(nthreads)), Shield<SEXP>(Rcpp::wrap(block_size)), Shield<SEXP>(Rcpp::wrap(block_hash)), Shield<SEXP>(Rcpp::wrap(string_dedup)), Shield<SEXP>(Rcpp::wrap(block_index)), Shield<SEXP>(Rcpp::wrap(raw_blocks)), Shield<SEXP>(Rcpp::wrap(string_dict)), Shield<SEXP>(Rcpp::wrap(string_columnar)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -384,16 +384,16 @@ namespace qs {
         return Rcpp::as<double >(rcpp_result_gen);
     }
 
-    inline double qsave_handle(SEXP const x, SEXP const handle, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15, const bool check_hash = true) {
-        typedef SEXP(*Ptr_qsave_handle)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
+    inline double qsave_handle(SEXP const x, SEXP const handle, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15, const bool check_hash = true, const int block_size = 524288, const bool block_hash = false, const bool string_dedup = false, const bool block_index = false, const bool raw_blocks = false, const bool string_dict = false, const bool string_columnar = false) {
+        typedef SEXP(*Ptr_qsave_handle)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
         static Ptr_qsave_handle p_qsave_handle = NULL;
         if (p_qsave_handle == NULL) {
-            validateSignature("double(*qsave_handle)(SEXP const,SEXP const,const std::string,const std::string,const int,const int,const bool)");
+            validateSignature("double(*qsave_handle)(SEXP const,SEXP const,const std::string,const std::string,const int,const int,const bool,const int,const bool,const bool,const bool,const bool,const bool,const bool)");
             p_qsave_handle = (Ptr_qsave_handle)R_GetCCallable("qs", "_qs_qsave_handle");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qsave_handle(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(handle)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)));
+            rcpp_result_gen = p_qsave_handle(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(handle)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)), Shield<SEXP>(Rcpp::wrap(block_size)), Shield<SEXP>(Rcpp::wrap(block_hash)), Shield<SEXP>(Rcpp::wrap(string_dedup)), Shield<SEXP>(Rcpp::wrap(block_index)), Shield<SEXP>(Rcpp::wrap(raw_blocks)), Shield<SEXP>(Rcpp::wrap(string_dict)), Shield<SEXP>(Rcpp::wrap(string_columnar)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -404,16 +404,16 @@ namespace qs {
         return Rcpp::as<double >(rcpp_result_gen);
     }
 
-    inline RawVector qserialize(SEXP const x, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15, const bool check_hash = true) {
-        typedef SEXP(*Ptr_qserialize)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
+    inline RawVector qserialize(SEXP const x, const std::string preset = "high", const std::string algorithm = "zstd", const int compress_level = 4L, const int shuffle_control = 15, const bool check_hash = true, const int nthreads = 1, const int block_size = 524288, SEXP const dictionary = R_NilValue, const bool block_hash = false, const bool string_dedup = false, const bool block_index = false, const bool raw_blocks = false, const bool string_dict = false, const bool string_columnar = false) {
+        typedef SEXP(*Ptr_qserialize)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
         static Ptr_qserialize p_qserialize = NULL;
         if (p_qserialize == NULL) {
-            validateSignature("RawVector(*qserialize)(SEXP const,const std::string,const std::string,const int,const int,const bool)");
+            validateSignature("RawVector(*qserialize)(SEXP const,const std::string,const std::string,const int,const int,const bool,const int,const int,SEXP const,const bool,const bool,const bool,const bool,const bool,const bool)");
             p_qserialize = (Ptr_qserialize)R_GetCCallable("qs", "_qs_qserialize");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qserialize(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)));
+            rcpp_result_gen = p_qserialize(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(preset)), Shield<SEXP>(Rcpp::wrap(algorithm)), Shield<SEXP>(Rcpp::wrap(compress_level)), Shield<SEXP>(Rcpp::wrap(shuffle_control)), Shield<SEXP>(Rcpp::wrap(check_hash)), Shield<SEXP>(Rcpp::wrap(nthreads)), Shield<SEXP>(Rcpp::wrap(block_size)), Shield<SEXP>(Rcpp::wrap(dictionary)), Shield<SEXP>(Rcpp::wrap(block_hash)), Shield<SEXP>(Rcpp::wrap(string_dedup)), Shield<SEXP>(Rcpp::wrap(block_index)), Shield<SEXP>(Rcpp::wrap(raw_blocks)), Shield<SEXP>(Rcpp::wrap(string_dict)), Shield<SEXP>(Rcpp::wrap(string_columnar)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -444,16 +444,36 @@ namespace qs {
         return Rcpp::as<RawVector >(rcpp_result_gen);
     }
 
-    inline SEXP qread(const std::string& file, const bool use_alt_rep = false, const bool strict = false, const int nthreads = 1) {
-        typedef SEXP(*Ptr_qread)(SEXP,SEXP,SEXP,SEXP);
+    inline SEXP qread(const std::string& file, const bool use_alt_rep = false, const bool strict = false, const int nthreads = 1, SEXP const columns = R_NilValue, const bool lazy = false) {
+        typedef SEXP(*Ptr_qread)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
         static Ptr_qread p_qread = NULL;
         if (p_qread == NULL) {
-            validateSignature("SEXP(*qread)(const std::string&,const bool,const bool,const int)");
+            validateSignature("SEXP(*qread)(const std::string&,const bool,const bool,const int,SEXP const,const bool)");
             p_qread = (Ptr_qread)R_GetCCallable("qs", "_qs_qread");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qread(Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)), Shield<SEXP>(Rcpp::wrap(nthreads)));
+            rcpp_result_gen = p_qread(Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)), Shield<SEXP>(Rcpp::wrap(nthreads)), Shield<SEXP>(Rcpp::wrap(columns)), Shield<SEXP>(Rcpp::wrap(lazy)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<SEXP >(rcpp_result_gen);
+    }
+
+    inline SEXP qread_elements(const std::string& file, SEXP const elements, const bool use_alt_rep = false, const bool lazy = false, const bool strict = false, const int nthreads = 1) {
+        typedef SEXP(*Ptr_qread_elements)(SEXP,SEXP,SEXP,SEXP,SEXP,SEXP);
+        static Ptr_qread_elements p_qread_elements = NULL;
+        if (p_qread_elements == NULL) {
+            validateSignature("SEXP(*qread_elements)(const std::string&,SEXP const,const bool,const bool,const bool,const int)");
+            p_qread_elements = (Ptr_qread_elements)R_GetCCallable("qs", "_qs_qread_elements");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_qread_elements(Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(elements)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(lazy)), Shield<SEXP>(Rcpp::wrap(strict)), Shield<SEXP>(Rcpp::wrap(nthreads)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -504,16 +524,16 @@ namespace qs {
         return Rcpp::as<SEXP >(rcpp_result_gen);
     }
 
-    inline SEXP qread_fd(const int fd, const bool use_alt_rep = false, const bool strict = false) {
-        typedef SEXP(*Ptr_qread_fd)(SEXP,SEXP,SEXP);
+    inline SEXP qread_fd(const int fd, const bool use_alt_rep = false, const bool strict = false, const int nthreads = 1) {
+        typedef SEXP(*Ptr_qread_fd)(SEXP,SEXP,SEXP,SEXP);
         static Ptr_qread_fd p_qread_fd = NULL;
         if (p_qread_fd == NULL) {
-            validateSignature("SEXP(*qread_fd)(const int,const bool,const bool)");
+            validateSignature("SEXP(*qread_fd)(const int,const bool,const bool,const int)");
             p_qread_fd = (Ptr_qread_fd)R_GetCCallable("qs", "_qs_qread_fd");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qread_fd(Shield<SEXP>(Rcpp::wrap(fd)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)));
+            rcpp_result_gen = p_qread_fd(Shield<SEXP>(Rcpp::wrap(fd)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)), Shield<SEXP>(Rcpp::wrap(nthreads)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -544,16 +564,16 @@ namespace qs {
         return Rcpp::as<SEXP >(rcpp_result_gen);
     }
 
-    inline SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep = false, const bool strict = false) {
-        typedef SEXP(*Ptr_qread_ptr)(SEXP,SEXP,SEXP,SEXP);
+    inline SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep = false, const bool strict = false, const int nthreads = 1) {
+        typedef SEXP(*Ptr_qread_ptr)(SEXP,SEXP,SEXP,SEXP,SEXP);
         static Ptr_qread_ptr p_qread_ptr = NULL;
         if (p_qread_ptr == NULL) {
-            validateSignature("SEXP(*qread_ptr)(SEXP const,const double,const bool,const bool)");
+            validateSignature("SEXP(*qread_ptr)(SEXP const,const double,const bool,const bool,const int)");
             p_qread_ptr = (Ptr_qread_ptr)R_GetCCallable("qs", "_qs_qread_ptr");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qread_ptr(Shield<SEXP>(Rcpp::wrap(pointer)), Shield<SEXP>(Rcpp::wrap(length)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)));
+            rcpp_result_gen = p_qread_ptr(Shield<SEXP>(Rcpp::wrap(pointer)), Shield<SEXP>(Rcpp::wrap(length)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)), Shield<SEXP>(Rcpp::wrap(nthreads)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -564,16 +584,36 @@ namespace qs {
         return Rcpp::as<SEXP >(rcpp_result_gen);
     }
 
-    inline SEXP qdeserialize(SEXP const x, const bool use_alt_rep = false, const bool strict = false) {
-        typedef SEXP(*Ptr_qdeserialize)(SEXP,SEXP,SEXP);
+    inline SEXP qread_mmap(const std::string& file, const bool use_alt_rep = false, const bool strict = false) {
+        typedef SEXP(*Ptr_qread_mmap)(SEXP,SEXP,SEXP);
+        static Ptr_qread_mmap p_qread_mmap = NULL;
+        if (p_qread_mmap == NULL) {
+            validateSignature("SEXP(*qread_mmap)(const std::string&,const bool,const bool)");
+            p_qread_mmap = (Ptr_qread_mmap)R_GetCCallable("qs", "_qs_qread_mmap");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_qread_mmap(Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<SEXP >(rcpp_result_gen);
+    }
+
+    inline SEXP qdeserialize(SEXP const x, const bool use_alt_rep = false, const bool strict = false, const int nthreads = 1) {
+        typedef SEXP(*Ptr_qdeserialize)(SEXP,SEXP,SEXP,SEXP);
         static Ptr_qdeserialize p_qdeserialize = NULL;
         if (p_qdeserialize == NULL) {
-            validateSignature("SEXP(*qdeserialize)(SEXP const,const bool,const bool)");
+            validateSignature("SEXP(*qdeserialize)(SEXP const,const bool,const bool,const int)");
             p_qdeserialize = (Ptr_qdeserialize)R_GetCCallable("qs", "_qs_qdeserialize");
         }
         RObject rcpp_result_gen;
         {
-            rcpp_result_gen = p_qdeserialize(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)));
+            rcpp_result_gen = p_qdeserialize(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(use_alt_rep)), Shield<SEXP>(Rcpp::wrap(strict)), Shield<SEXP>(Rcpp::wrap(nthreads)));
         }
         if (rcpp_result_gen.inherits("interrupted-error"))
             throw Rcpp::internal::InterruptedException();
@@ -624,6 +664,46 @@ namespace qs {
         return Rcpp::as<RObject >(rcpp_result_gen);
     }
 
+    inline List qverify(const std::string& file, const int nthreads = 1) {
+        typedef SEXP(*Ptr_qverify)(SEXP,SEXP);
+        static Ptr_qverify p_qverify = NULL;
+        if (p_qverify == NULL) {
+            validateSignature("List(*qverify)(const std::string&,const int)");
+            p_qverify = (Ptr_qverify)R_GetCCallable("qs", "_qs_qverify");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_qverify(Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(nthreads)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<List >(rcpp_result_gen);
+    }
+
+    inline List qinspect(const std::string& file, SEXP const blocks = R_NilValue) {
+        typedef SEXP(*Ptr_qinspect)(SEXP,SEXP);
+        static Ptr_qinspect p_qinspect = NULL;
+        if (p_qinspect == NULL) {
+            validateSignature("List(*qinspect)(const std::string&,SEXP const)");
+            p_qinspect = (Ptr_qinspect)R_GetCCallable("qs", "_qs_qinspect");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_qinspect(Shield<SEXP>(Rcpp::wrap(file)), Shield<SEXP>(Rcpp::wrap(blocks)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<List >(rcpp_result_gen);
+    }
+
     inline int openFd(const std::string& file, const std::string& mode) {
         typedef SEXP(*Ptr_openFd)(SEXP,SEXP);
         static Ptr_openFd p_openFd = NULL;
@@ -902,6 +982,66 @@ namespace qs {
         return Rcpp::as<bool >(rcpp_result_gen);
     }
 
+    inline int set_thread_pool_size(const int nthreads) {
+        typedef SEXP(*Ptr_set_thread_pool_size)(SEXP);
+        static Ptr_set_thread_pool_size p_set_thread_pool_size = NULL;
+        if (p_set_thread_pool_size == NULL) {
+            validateSignature("int(*set_thread_pool_size)(const int)");
+            p_set_thread_pool_size = (Ptr_set_thread_pool_size)R_GetCCallable("qs", "_qs_set_thread_pool_size");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_set_thread_pool_size(Shield<SEXP>(Rcpp::wrap(nthreads)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<int >(rcpp_result_gen);
+    }
+
+    inline RawVector zstd_train_dictionary(List x, const int dict_size = 112640, const int shuffle_control = 15) {
+        typedef SEXP(*Ptr_zstd_train_dictionary)(SEXP,SEXP,SEXP);
+        static Ptr_zstd_train_dictionary p_zstd_train_dictionary = NULL;
+        if (p_zstd_train_dictionary == NULL) {
+            validateSignature("RawVector(*zstd_train_dictionary)(List,const int,const int)");
+            p_zstd_train_dictionary = (Ptr_zstd_train_dictionary)R_GetCCallable("qs", "_qs_zstd_train_dictionary");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_zstd_train_dictionary(Shield<SEXP>(Rcpp::wrap(x)), Shield<SEXP>(Rcpp::wrap(dict_size)), Shield<SEXP>(Rcpp::wrap(shuffle_control)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<RawVector >(rcpp_result_gen);
+    }
+
+    inline double register_zstd_dictionary(SEXP const dictionary) {
+        typedef SEXP(*Ptr_register_zstd_dictionary)(SEXP);
+        static Ptr_register_zstd_dictionary p_register_zstd_dictionary = NULL;
+        if (p_register_zstd_dictionary == NULL) {
+            validateSignature("double(*register_zstd_dictionary)(SEXP const)");
+            p_register_zstd_dictionary = (Ptr_register_zstd_dictionary)R_GetCCallable("qs", "_qs_register_zstd_dictionary");
+        }
+        RObject rcpp_result_gen;
+        {
+            rcpp_result_gen = p_register_zstd_dictionary(Shield<SEXP>(Rcpp::wrap(dictionary)));
+        }
+        if (rcpp_result_gen.inherits("interrupted-error"))
+            throw Rcpp::internal::InterruptedException();
+        if (Rcpp::internal::isLongjumpSentinel(rcpp_result_gen))
+            throw Rcpp::LongjumpException(rcpp_result_gen);
+        if (rcpp_result_gen.inherits("try-error"))
+            throw Rcpp::exception(Rcpp::as<std::string>(rcpp_result_gen).c_str());
+        return Rcpp::as<double >(rcpp_result_gen);
+    }
+
 }
 
 #endif // RCPP_qs_RCPPEXPORTS_H_GEN_
@@ -511,8 +511,8 @@ RcppExport SEXP _qs_is_big_endian() {
     return rcpp_result_gen;
 }
 // qsave
-double qsave(SEXP const x, const std::string& file, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash, const int nthreads);
-static SEXP _qs_qsave_try(SEXP xSEXP, SEXP fileSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP) {
+double qsave(SEXP const x, const std::string& file, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash, const int nthreads, const int block_size, const bool block_hash, const bool string_dedup, const bool block_index, const bool raw_blocks, const bool string_dict, const bool string_columnar);
+static SEXP _qs_qsave_try(SEXP xSEXP, SEXP fileSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP, SEXP block_sizeSEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< SEXP const >::type x(xSEXP);
@@ -523,14 +523,21 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const int >::type shuffle_control(shuffle_controlSEXP);
     Rcpp::traits::input_parameter< const bool >::type check_hash(check_hashSEXP);
     Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
-    rcpp_result_gen = Rcpp::wrap(qsave(x, file, preset, algorithm, compress_level, shuffle_control, check_hash, nthreads));
+    Rcpp::traits::input_parameter< const int >::type block_size(block_sizeSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_hash(block_hashSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dedup(string_dedupSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_index(block_indexSEXP);
+    Rcpp::traits::input_parameter< const bool >::type raw_blocks(raw_blocksSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dict(string_dictSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_columnar(string_columnarSEXP);
+    rcpp_result_gen = Rcpp::wrap(qsave(x, file, preset, algorithm, compress_level, shuffle_control, check_hash, nthreads, block_size, block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qsave(SEXP xSEXP, SEXP fileSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP) {
+RcppExport SEXP _qs_qsave(SEXP xSEXP, SEXP fileSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP, SEXP block_sizeSEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qsave_try(xSEXP, fileSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP, nthreadsSEXP));
+        rcpp_result_gen = PROTECT(_qs_qsave_try(xSEXP, fileSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP, nthreadsSEXP, block_sizeSEXP, block_hashSEXP, string_dedupSEXP, block_indexSEXP, raw_blocksSEXP, string_dictSEXP, string_columnarSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -591,8 +598,8 @@ RcppExport SEXP _qs_c_qsave(SEXP xSEXP, SEXP fileSEXP, SEXP presetSEXP, SEXP alg
     return rcpp_result_gen;
 }
 // qsave_fd
-double qsave_fd(SEXP const x, const int fd, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash);
-static SEXP _qs_qsave_fd_try(SEXP xSEXP, SEXP fdSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP) {
+double qsave_fd(SEXP const x, const int fd, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash, const int nthreads, const int block_size, const bool block_hash, const bool string_dedup, const bool block_index, const bool raw_blocks, const bool string_dict, const bool string_columnar);
+static SEXP _qs_qsave_fd_try(SEXP xSEXP, SEXP fdSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP, SEXP block_sizeSEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< SEXP const >::type x(xSEXP);
@@ -602,14 +609,22 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const int >::type compress_level(compress_levelSEXP);
     Rcpp::traits::input_parameter< const int >::type shuffle_control(shuffle_controlSEXP);
     Rcpp::traits::input_parameter< const bool >::type check_hash(check_hashSEXP);
-    rcpp_result_gen = Rcpp::wrap(qsave_fd(x, fd, preset, algorithm, compress_level, shuffle_control, check_hash));
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< const int >::type block_size(block_sizeSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_hash(block_hashSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dedup(string_dedupSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_index(block_indexSEXP);
+    Rcpp::traits::input_parameter< const bool >::type raw_blocks(raw_blocksSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dict(string_dictSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_columnar(string_columnarSEXP);
+    rcpp_result_gen = Rcpp::wrap(qsave_fd(x, fd, preset, algorithm, compress_level, shuffle_control, check_hash, nthreads, block_size, block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qsave_fd(SEXP xSEXP, SEXP fdSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP) {
+RcppExport SEXP _qs_qsave_fd(SEXP xSEXP, SEXP fdSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP, SEXP block_sizeSEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qsave_fd_try(xSEXP, fdSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP));
+        rcpp_result_gen = PROTECT(_qs_qsave_fd_try(xSEXP, fdSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP, nthreadsSEXP, block_sizeSEXP, block_hashSEXP, string_dedupSEXP, block_indexSEXP, raw_blocksSEXP, string_dictSEXP, string_columnarSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -630,8 +645,8 @@ RcppExport SEXP _qs_qsave_fd(SEXP xSEXP, SEXP fdSEXP, SEXP presetSEXP, SEXP algo
     return rcpp_result_gen;
 }
 // qsave_handle
-double qsave_handle(SEXP const x, SEXP const handle, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash);
-static SEXP _qs_qsave_handle_try(SEXP xSEXP, SEXP handleSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP) {
+double qsave_handle(SEXP const x, SEXP const handle, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash, const int block_size, const bool block_hash, const bool string_dedup, const bool block_index, const bool raw_blocks, const bool string_dict, const bool string_columnar);
+static SEXP _qs_qsave_handle_try(SEXP xSEXP, SEXP handleSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP block_sizeSEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< SEXP const >::type x(xSEXP);
@@ -641,14 +656,21 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const int >::type compress_level(compress_levelSEXP);
     Rcpp::traits::input_parameter< const int >::type shuffle_control(shuffle_controlSEXP);
     Rcpp::traits::input_parameter< const bool >::type check_hash(check_hashSEXP);
-    rcpp_result_gen = Rcpp::wrap(qsave_handle(x, handle, preset, algorithm, compress_level, shuffle_control, check_hash));
+    Rcpp::traits::input_parameter< const int >::type block_size(block_sizeSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_hash(block_hashSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dedup(string_dedupSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_index(block_indexSEXP);
+    Rcpp::traits::input_parameter< const bool >::type raw_blocks(raw_blocksSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dict(string_dictSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_columnar(string_columnarSEXP);
+    rcpp_result_gen = Rcpp::wrap(qsave_handle(x, handle, preset, algorithm, compress_level, shuffle_control, check_hash, block_size, block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qsave_handle(SEXP xSEXP, SEXP handleSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP) {
+RcppExport SEXP _qs_qsave_handle(SEXP xSEXP, SEXP handleSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP block_sizeSEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qsave_handle_try(xSEXP, handleSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP));
+        rcpp_result_gen = PROTECT(_qs_qsave_handle_try(xSEXP, handleSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP, block_sizeSEXP, block_hashSEXP, string_dedupSEXP, block_indexSEXP, raw_blocksSEXP, string_dictSEXP, string_columnarSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -669,8 +691,8 @@ RcppExport SEXP _qs_qsave_handle(SEXP xSEXP, SEXP handleSEXP, SEXP presetSEXP, S
     return rcpp_result_gen;
 }
 // qserialize
-RawVector qserialize(SEXP const x, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash);
-static SEXP _qs_qserialize_try(SEXP xSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP) {
+RawVector qserialize(SEXP const x, const std::string preset, const std::string algorithm, const int compress_level, const int shuffle_control, const bool check_hash, const int nthreads, const int block_size, SEXP const dictionary, const bool block_hash, const bool string_dedup, const bool block_index, const bool raw_blocks, const bool string_dict, const bool string_columnar);
+static SEXP _qs_qserialize_try(SEXP xSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP, SEXP block_sizeSEXP, SEXP dictionarySEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< SEXP const >::type x(xSEXP);
@@ -679,14 +701,23 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< const int >::type compress_level(compress_levelSEXP);
     Rcpp::traits::input_parameter< const int >::type shuffle_control(shuffle_controlSEXP);
     Rcpp::traits::input_parameter< const bool >::type check_hash(check_hashSEXP);
-    rcpp_result_gen = Rcpp::wrap(qserialize(x, preset, algorithm, compress_level, shuffle_control, check_hash));
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< const int >::type block_size(block_sizeSEXP);
+    Rcpp::traits::input_parameter< SEXP const >::type dictionary(dictionarySEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_hash(block_hashSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dedup(string_dedupSEXP);
+    Rcpp::traits::input_parameter< const bool >::type block_index(block_indexSEXP);
+    Rcpp::traits::input_parameter< const bool >::type raw_blocks(raw_blocksSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_dict(string_dictSEXP);
+    Rcpp::traits::input_parameter< const bool >::type string_columnar(string_columnarSEXP);
+    rcpp_result_gen = Rcpp::wrap(qserialize(x, preset, algorithm, compress_level, shuffle_control, check_hash, nthreads, block_size, dictionary, block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qserialize(SEXP xSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP) {
+RcppExport SEXP _qs_qserialize(SEXP xSEXP, SEXP presetSEXP, SEXP algorithmSEXP, SEXP compress_levelSEXP, SEXP shuffle_controlSEXP, SEXP check_hashSEXP, SEXP nthreadsSEXP, SEXP block_sizeSEXP, SEXP dictionarySEXP, SEXP block_hashSEXP, SEXP string_dedupSEXP, SEXP block_indexSEXP, SEXP raw_blocksSEXP, SEXP string_dictSEXP, SEXP string_columnarSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qserialize_try(xSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP));
+        rcpp_result_gen = PROTECT(_qs_qserialize_try(xSEXP, presetSEXP, algorithmSEXP, compress_levelSEXP, shuffle_controlSEXP, check_hashSEXP, nthreadsSEXP, block_sizeSEXP, dictionarySEXP, block_hashSEXP, string_dedupSEXP, block_indexSEXP, raw_blocksSEXP, string_dictSEXP, string_columnarSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -745,22 +776,62 @@ RcppExport SEXP _qs_c_qserialize(SEXP xSEXP, SEXP presetSEXP, SEXP algorithmSEXP
     return rcpp_result_gen;
 }
 // qread
-SEXP qread(const std::string& file, const bool use_alt_rep, const bool strict, const int nthreads);
-static SEXP _qs_qread_try(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
+SEXP qread(const std::string& file, const bool use_alt_rep, const bool strict, const int nthreads, SEXP const columns, const bool lazy);
+static SEXP _qs_qread_try(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP, SEXP columnsSEXP, SEXP lazySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const bool >::type use_alt_rep(use_alt_repSEXP);
+    Rcpp::traits::input_parameter< const bool >::type strict(strictSEXP);
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< SEXP const >::type columns(columnsSEXP);
+    Rcpp::traits::input_parameter< const bool >::type lazy(lazySEXP);
+    rcpp_result_gen = Rcpp::wrap(qread(file, use_alt_rep, strict, nthreads, columns, lazy));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_qread(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP, SEXP columnsSEXP, SEXP lazySEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_qread_try(fileSEXP, use_alt_repSEXP, strictSEXP, nthreadsSEXP, columnsSEXP, lazySEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// qread_elements
+SEXP qread_elements(const std::string& file, SEXP const elements, const bool use_alt_rep, const bool lazy, const bool strict, const int nthreads);
+static SEXP _qs_qread_elements_try(SEXP fileSEXP, SEXP elementsSEXP, SEXP use_alt_repSEXP, SEXP lazySEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< SEXP const >::type elements(elementsSEXP);
     Rcpp::traits::input_parameter< const bool >::type use_alt_rep(use_alt_repSEXP);
+    Rcpp::traits::input_parameter< const bool >::type lazy(lazySEXP);
     Rcpp::traits::input_parameter< const bool >::type strict(strictSEXP);
     Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
-    rcpp_result_gen = Rcpp::wrap(qread(file, use_alt_rep, strict, nthreads));
+    rcpp_result_gen = Rcpp::wrap(qread_elements(file, elements, use_alt_rep, lazy, strict, nthreads));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qread(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
+RcppExport SEXP _qs_qread_elements(SEXP fileSEXP, SEXP elementsSEXP, SEXP use_alt_repSEXP, SEXP lazySEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qread_try(fileSEXP, use_alt_repSEXP, strictSEXP, nthreadsSEXP));
+        rcpp_result_gen = PROTECT(_qs_qread_elements_try(fileSEXP, elementsSEXP, use_alt_repSEXP, lazySEXP, strictSEXP, nthreadsSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -853,21 +924,22 @@ RcppExport SEXP _qs_c_qread(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP
     return rcpp_result_gen;
 }
 // qread_fd
-SEXP qread_fd(const int fd, const bool use_alt_rep, const bool strict);
-static SEXP _qs_qread_fd_try(SEXP fdSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+SEXP qread_fd(const int fd, const bool use_alt_rep, const bool strict, const int nthreads);
+static SEXP _qs_qread_fd_try(SEXP fdSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< const int >::type fd(fdSEXP);
     Rcpp::traits::input_parameter< const bool >::type use_alt_rep(use_alt_repSEXP);
     Rcpp::traits::input_parameter< const bool >::type strict(strictSEXP);
-    rcpp_result_gen = Rcpp::wrap(qread_fd(fd, use_alt_rep, strict));
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(qread_fd(fd, use_alt_rep, strict, nthreads));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qread_fd(SEXP fdSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+RcppExport SEXP _qs_qread_fd(SEXP fdSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qread_fd_try(fdSEXP, use_alt_repSEXP, strictSEXP));
+        rcpp_result_gen = PROTECT(_qs_qread_fd_try(fdSEXP, use_alt_repSEXP, strictSEXP, nthreadsSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -923,22 +995,58 @@ RcppExport SEXP _qs_qread_handle(SEXP handleSEXP, SEXP use_alt_repSEXP, SEXP str
     return rcpp_result_gen;
 }
 // qread_ptr
-SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep, const bool strict);
-static SEXP _qs_qread_ptr_try(SEXP pointerSEXP, SEXP lengthSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep, const bool strict, const int nthreads);
+static SEXP _qs_qread_ptr_try(SEXP pointerSEXP, SEXP lengthSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< SEXP const >::type pointer(pointerSEXP);
     Rcpp::traits::input_parameter< const double >::type length(lengthSEXP);
     Rcpp::traits::input_parameter< const bool >::type use_alt_rep(use_alt_repSEXP);
     Rcpp::traits::input_parameter< const bool >::type strict(strictSEXP);
-    rcpp_result_gen = Rcpp::wrap(qread_ptr(pointer, length, use_alt_rep, strict));
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(qread_ptr(pointer, length, use_alt_rep, strict, nthreads));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_qread_ptr(SEXP pointerSEXP, SEXP lengthSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_qread_ptr_try(pointerSEXP, lengthSEXP, use_alt_repSEXP, strictSEXP, nthreadsSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// qread_mmap
+SEXP qread_mmap(const std::string& file, const bool use_alt_rep, const bool strict);
+static SEXP _qs_qread_mmap_try(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const bool >::type use_alt_rep(use_alt_repSEXP);
+    Rcpp::traits::input_parameter< const bool >::type strict(strictSEXP);
+    rcpp_result_gen = Rcpp::wrap(qread_mmap(file, use_alt_rep, strict));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qread_ptr(SEXP pointerSEXP, SEXP lengthSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+RcppExport SEXP _qs_qread_mmap(SEXP fileSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qread_ptr_try(pointerSEXP, lengthSEXP, use_alt_repSEXP, strictSEXP));
+        rcpp_result_gen = PROTECT(_qs_qread_mmap_try(fileSEXP, use_alt_repSEXP, strictSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -959,21 +1067,22 @@ RcppExport SEXP _qs_qread_ptr(SEXP pointerSEXP, SEXP lengthSEXP, SEXP use_alt_re
     return rcpp_result_gen;
 }
 // qdeserialize
-SEXP qdeserialize(SEXP const x, const bool use_alt_rep, const bool strict);
-static SEXP _qs_qdeserialize_try(SEXP xSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+SEXP qdeserialize(SEXP const x, const bool use_alt_rep, const bool strict, const int nthreads);
+static SEXP _qs_qdeserialize_try(SEXP xSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::traits::input_parameter< SEXP const >::type x(xSEXP);
     Rcpp::traits::input_parameter< const bool >::type use_alt_rep(use_alt_repSEXP);
     Rcpp::traits::input_parameter< const bool >::type strict(strictSEXP);
-    rcpp_result_gen = Rcpp::wrap(qdeserialize(x, use_alt_rep, strict));
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(qdeserialize(x, use_alt_rep, strict, nthreads));
     return rcpp_result_gen;
 END_RCPP_RETURN_ERROR
 }
-RcppExport SEXP _qs_qdeserialize(SEXP xSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP) {
+RcppExport SEXP _qs_qdeserialize(SEXP xSEXP, SEXP use_alt_repSEXP, SEXP strictSEXP, SEXP nthreadsSEXP) {
     SEXP rcpp_result_gen;
     {
-        rcpp_result_gen = PROTECT(_qs_qdeserialize_try(xSEXP, use_alt_repSEXP, strictSEXP));
+        rcpp_result_gen = PROTECT(_qs_qdeserialize_try(xSEXP, use_alt_repSEXP, strictSEXP, nthreadsSEXP));
     }
     Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
     if (rcpp_isInterrupt_gen) {
@@ -1061,6 +1170,74 @@ RcppExport SEXP _qs_qdump(SEXP fileSEXP) {
     UNPROTECT(1);
     return rcpp_result_gen;
 }
+// qverify
+List qverify(const std::string& file, const int nthreads);
+static SEXP _qs_qverify_try(SEXP fileSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(qverify(file, nthreads));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_qverify(SEXP fileSEXP, SEXP nthreadsSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_qverify_try(fileSEXP, nthreadsSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// qinspect
+List qinspect(const std::string& file, SEXP const blocks);
+static SEXP _qs_qinspect_try(SEXP fileSEXP, SEXP blocksSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< const std::string& >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< SEXP const >::type blocks(blocksSEXP);
+    rcpp_result_gen = Rcpp::wrap(qinspect(file, blocks));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_qinspect(SEXP fileSEXP, SEXP blocksSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_qinspect_try(fileSEXP, blocksSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
 // openFd
 int openFd(const std::string& file, const std::string& mode);
 static SEXP _qs_openFd_try(SEXP fileSEXP, SEXP modeSEXP) {
@@ -1530,6 +1707,107 @@ RcppExport SEXP _qs_set_trust_promises(SEXP valueSEXP) {
     UNPROTECT(1);
     return rcpp_result_gen;
 }
+// set_thread_pool_size
+int set_thread_pool_size(const int nthreads);
+static SEXP _qs_set_thread_pool_size_try(SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< const int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(set_thread_pool_size(nthreads));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_set_thread_pool_size(SEXP nthreadsSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_set_thread_pool_size_try(nthreadsSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// zstd_train_dictionary
+RawVector zstd_train_dictionary(List x, const int dict_size, const int shuffle_control);
+static SEXP _qs_zstd_train_dictionary_try(SEXP xSEXP, SEXP dict_sizeSEXP, SEXP shuffle_controlSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< List >::type x(xSEXP);
+    Rcpp::traits::input_parameter< const int >::type dict_size(dict_sizeSEXP);
+    Rcpp::traits::input_parameter< const int >::type shuffle_control(shuffle_controlSEXP);
+    rcpp_result_gen = Rcpp::wrap(zstd_train_dictionary(x, dict_size, shuffle_control));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_zstd_train_dictionary(SEXP xSEXP, SEXP dict_sizeSEXP, SEXP shuffle_controlSEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_zstd_train_dictionary_try(xSEXP, dict_sizeSEXP, shuffle_controlSEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
+// register_zstd_dictionary
+double register_zstd_dictionary(SEXP const dictionary);
+static SEXP _qs_register_zstd_dictionary_try(SEXP dictionarySEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::traits::input_parameter< SEXP const >::type dictionary(dictionarySEXP);
+    rcpp_result_gen = Rcpp::wrap(register_zstd_dictionary(dictionary));
+    return rcpp_result_gen;
+END_RCPP_RETURN_ERROR
+}
+RcppExport SEXP _qs_register_zstd_dictionary(SEXP dictionarySEXP) {
+    SEXP rcpp_result_gen;
+    {
+        rcpp_result_gen = PROTECT(_qs_register_zstd_dictionary_try(dictionarySEXP));
+    }
+    Rboolean rcpp_isInterrupt_gen = Rf_inherits(rcpp_result_gen, "interrupted-error");
+    if (rcpp_isInterrupt_gen) {
+        UNPROTECT(1);
+        Rf_onintr();
+    }
+    bool rcpp_isLongjump_gen = Rcpp::internal::isLongjumpSentinel(rcpp_result_gen);
+    if (rcpp_isLongjump_gen) {
+        Rcpp::internal::resumeJump(rcpp_result_gen);
+    }
+    Rboolean rcpp_isError_gen = Rf_inherits(rcpp_result_gen, "try-error");
+    if (rcpp_isError_gen) {
+        SEXP rcpp_msgSEXP_gen = Rf_asChar(rcpp_result_gen);
+        UNPROTECT(1);
+        Rf_error("%s", CHAR(rcpp_msgSEXP_gen));
+    }
+    UNPROTECT(1);
+    return rcpp_result_gen;
+}
 
 // validate (ensure exported C++ functions exist before calling them)
 static int _qs_RcppExport_validate(const char* sig) { 
@@ -1550,21 +1828,25 @@ static int _qs_RcppExport_validate(const char* sig) {
         signatures.insert("std::string(*c_base91_encode)(const RawVector&)");
         signatures.insert("RawVector(*c_base91_decode)(const std::string&)");
         signatures.insert("bool(*is_big_endian)()");
-        signatures.insert("double(*qsave)(SEXP const,const std::string&,const std::string,const std::string,const int,const int,const bool,const int)");
+        signatures.insert("double(*qsave)(SEXP const,const std::string&,const std::string,const std::string,const int,const int,const bool,const int,const int,const bool,const bool,const bool,const bool,const bool,const bool)");
         signatures.insert("double(*c_qsave)(SEXP const,const std::string&,const std::string,const std::string,const int,const int,const bool,const int)");
-        signatures.insert("double(*qsave_fd)(SEXP const,const int,const std::string,const std::string,const int,const int,const bool)");
-        signatures.insert("double(*qsave_handle)(SEXP const,SEXP const,const std::string,const std::string,const int,const int,const bool)");
-        signatures.insert("RawVector(*qserialize)(SEXP const,const std::string,const std::string,const int,const int,const bool)");
+        signatures.insert("double(*qsave_fd)(SEXP const,const int,const std::string,const std::string,const int,const int,const bool,const int,const int,const bool,const bool,const bool,const bool,const bool,const bool)");
+        signatures.insert("double(*qsave_handle)(SEXP const,SEXP const,const std::string,const std::string,const int,const int,const bool,const int,const bool,const bool,const bool,const bool,const bool,const bool)");
+        signatures.insert("RawVector(*qserialize)(SEXP const,const std::string,const std::string,const int,const int,const bool,const int,const int,SEXP const,const bool,const bool,const bool,const bool,const bool,const bool)");
         signatures.insert("RawVector(*c_qserialize)(SEXP const,const std::string,const std::string,const int,const int,const bool)");
-        signatures.insert("SEXP(*qread)(const std::string&,const bool,const bool,const int)");
+        signatures.insert("SEXP(*qread)(const std::string&,const bool,const bool,const int,SEXP const,const bool)");
+        signatures.insert("SEXP(*qread_elements)(const std::string&,SEXP const,const bool,const bool,const bool,const int)");
         signatures.insert("SEXP(*c_qattributes)(const std::string&,const bool,const bool,const int)");
         signatures.insert("SEXP(*c_qread)(const std::string&,const bool,const bool,const int)");
-        signatures.insert("SEXP(*qread_fd)(const int,const bool,const bool)");
+        signatures.insert("SEXP(*qread_fd)(const int,const bool,const bool,const int)");
         signatures.insert("SEXP(*qread_handle)(SEXP const,const bool,const bool)");
-        signatures.insert("SEXP(*qread_ptr)(SEXP const,const double,const bool,const bool)");
-        signatures.insert("SEXP(*qdeserialize)(SEXP const,const bool,const bool)");
+        signatures.insert("SEXP(*qread_ptr)(SEXP const,const double,const bool,const bool,const int)");
+        signatures.insert("SEXP(*qread_mmap)(const std::string&,const bool,const bool)");
+        signatures.insert("SEXP(*qdeserialize)(SEXP const,const bool,const bool,const int)");
         signatures.insert("SEXP(*c_qdeserialize)(SEXP const,const bool,const bool)");
         signatures.insert("RObject(*qdump)(const std::string&)");
+        signatures.insert("List(*qverify)(const std::string&,const int)");
+        signatures.insert("List(*qinspect)(const std::string&,SEXP const)");
         signatures.insert("int(*openFd)(const std::string&,const std::string&)");
         signatures.insert("SEXP(*readFdDirect)(const int,const int)");
         signatures.insert("int(*closeFd)(const int)");
@@ -1579,6 +1861,9 @@ static int _qs_RcppExport_validate(const char* sig) {
         signatures.insert("void(*unregister_altrep_class)(const std::string&,const std::string&)");
         signatures.insert("SEXP(*get_altrep_class_info)(SEXP)");
         signatures.insert("bool(*set_trust_promises)(bool)");
+        signatures.insert("int(*set_thread_pool_size)(const int)");
+        signatures.insert("RawVector(*zstd_train_dictionary)(List,const int,const int)");
+        signatures.insert("double(*register_zstd_dictionary)(SEXP const)");
     }
     return signatures.find(sig) != signatures.end();
 }
@@ -1607,14 +1892,18 @@ RcppExport SEXP _qs_RcppExport_registerCCallable() {
     R_RegisterCCallable("qs", "_qs_qserialize", (DL_FUNC)_qs_qserialize_try);
     R_RegisterCCallable("qs", "_qs_c_qserialize", (DL_FUNC)_qs_c_qserialize_try);
     R_RegisterCCallable("qs", "_qs_qread", (DL_FUNC)_qs_qread_try);
+    R_RegisterCCallable("qs", "_qs_qread_elements", (DL_FUNC)_qs_qread_elements_try);
     R_RegisterCCallable("qs", "_qs_c_qattributes", (DL_FUNC)_qs_c_qattributes_try);
     R_RegisterCCallable("qs", "_qs_c_qread", (DL_FUNC)_qs_c_qread_try);
     R_RegisterCCallable("qs", "_qs_qread_fd", (DL_FUNC)_qs_qread_fd_try);
     R_RegisterCCallable("qs", "_qs_qread_handle", (DL_FUNC)_qs_qread_handle_try);
     R_RegisterCCallable("qs", "_qs_qread_ptr", (DL_FUNC)_qs_qread_ptr_try);
+    R_RegisterCCallable("qs", "_qs_qread_mmap", (DL_FUNC)_qs_qread_mmap_try);
     R_RegisterCCallable("qs", "_qs_qdeserialize", (DL_FUNC)_qs_qdeserialize_try);
     R_RegisterCCallable("qs", "_qs_c_qdeserialize", (DL_FUNC)_qs_c_qdeserialize_try);
     R_RegisterCCallable("qs", "_qs_qdump", (DL_FUNC)_qs_qdump_try);
+    R_RegisterCCallable("qs", "_qs_qverify", (DL_FUNC)_qs_qverify_try);
+    R_RegisterCCallable("qs", "_qs_qinspect", (DL_FUNC)_qs_qinspect_try);
     R_RegisterCCallable("qs", "_qs_openFd", (DL_FUNC)_qs_openFd_try);
     R_RegisterCCallable("qs", "_qs_readFdDirect", (DL_FUNC)_qs_readFdDirect_try);
     R_RegisterCCallable("qs", "_qs_closeFd", (DL_FUNC)_qs_closeFd_try);
@@ -1629,6 +1918,9 @@ RcppExport SEXP _qs_RcppExport_registerCCallable() {
     R_RegisterCCallable("qs", "_qs_unregister_altrep_class", (DL_FUNC)_qs_unregister_altrep_class_try);
     R_RegisterCCallable("qs", "_qs_get_altrep_class_info", (DL_FUNC)_qs_get_altrep_class_info_try);
     R_RegisterCCallable("qs", "_qs_set_trust_promises", (DL_FUNC)_qs_set_trust_promises_try);
+    R_RegisterCCallable("qs", "_qs_set_thread_pool_size", (DL_FUNC)_qs_set_thread_pool_size_try);
+    R_RegisterCCallable("qs", "_qs_zstd_train_dictionary", (DL_FUNC)_qs_zstd_train_dictionary_try);
+    R_RegisterCCallable("qs", "_qs_register_zstd_dictionary", (DL_FUNC)_qs_register_zstd_dictionary_try);
     R_RegisterCCallable("qs", "_qs_RcppExport_validate", (DL_FUNC)_qs_RcppExport_validate);
     return R_NilValue;
 }
@@ -1649,21 +1941,25 @@ static const R_CallMethodDef CallEntries[] = {
     {"_qs_c_base91_encode", (DL_FUNC) &_qs_c_base91_encode, 1},
     {"_qs_c_base91_decode", (DL_FUNC) &_qs_c_base91_decode, 1},
     {"_qs_is_big_endian", (DL_FUNC) &_qs_is_big_endian, 0},
-    {"_qs_qsave", (DL_FUNC) &_qs_qsave, 8},
+    {"_qs_qsave", (DL_FUNC) &_qs_qsave, 15},
     {"_qs_c_qsave", (DL_FUNC) &_qs_c_qsave, 8},
-    {"_qs_qsave_fd", (DL_FUNC) &_qs_qsave_fd, 7},
-    {"_qs_qsave_handle", (DL_FUNC) &_qs_qsave_handle, 7},
-    {"_qs_qserialize", (DL_FUNC) &_qs_qserialize, 6},
+    {"_qs_qsave_fd", (DL_FUNC) &_qs_qsave_fd, 15},
+    {"_qs_qsave_handle", (DL_FUNC) &_qs_qsave_handle, 14},
+    {"_qs_qserialize", (DL_FUNC) &_qs_qserialize, 15},
     {"_qs_c_qserialize", (DL_FUNC) &_qs_c_qserialize, 6},
-    {"_qs_qread", (DL_FUNC) &_qs_qread, 4},
+    {"_qs_qread", (DL_FUNC) &_qs_qread, 6},
+    {"_qs_qread_elements", (DL_FUNC) &_qs_qread_elements, 6},
     {"_qs_c_qattributes", (DL_FUNC) &_qs_c_qattributes, 4},
     {"_qs_c_qread", (DL_FUNC) &_qs_c_qread, 4},
-    {"_qs_qread_fd", (DL_FUNC) &_qs_qread_fd, 3},
+    {"_qs_qread_fd", (DL_FUNC) &_qs_qread_fd, 4},
     {"_qs_qread_handle", (DL_FUNC) &_qs_qread_handle, 3},
-    {"_qs_qread_ptr", (DL_FUNC) &_qs_qread_ptr, 4},
-    {"_qs_qdeserialize", (DL_FUNC) &_qs_qdeserialize, 3},
+    {"_qs_qread_ptr", (DL_FUNC) &_qs_qread_ptr, 5},
+    {"_qs_qread_mmap", (DL_FUNC) &_qs_qread_mmap, 3},
+    {"_qs_qdeserialize", (DL_FUNC) &_qs_qdeserialize, 4},
     {"_qs_c_qdeserialize", (DL_FUNC) &_qs_c_qdeserialize, 3},
     {"_qs_qdump", (DL_FUNC) &_qs_qdump, 1},
+    {"_qs_qverify", (DL_FUNC) &_qs_qverify, 2},
+    {"_qs_qinspect", (DL_FUNC) &_qs_qinspect, 2},
     {"_qs_openFd", (DL_FUNC) &_qs_openFd, 2},
     {"_qs_readFdDirect", (DL_FUNC) &_qs_readFdDirect, 2},
     {"_qs_closeFd", (DL_FUNC) &_qs_closeFd, 1},
@@ -1678,11 +1974,16 @@ static const R_CallMethodDef CallEntries[] = {
     {"_qs_unregister_altrep_class", (DL_FUNC) &_qs_unregister_altrep_class, 2},
     {"_qs_get_altrep_class_info", (DL_FUNC) &_qs_get_altrep_class_info, 1},
     {"_qs_set_trust_promises", (DL_FUNC) &_qs_set_trust_promises, 1},
+    {"_qs_set_thread_pool_size", (DL_FUNC) &_qs_set_thread_pool_size, 1},
+    {"_qs_zstd_train_dictionary", (DL_FUNC) &_qs_zstd_train_dictionary, 3},
+    {"_qs_register_zstd_dictionary", (DL_FUNC) &_qs_register_zstd_dictionary, 1},
     {"_qs_RcppExport_registerCCallable", (DL_FUNC) &_qs_RcppExport_registerCCallable, 0},
     {NULL, NULL, 0}
 };
 
+void init_altrep_classes(DllInfo* dll);
 RcppExport void R_init_qs(DllInfo *dll) {
     R_registerRoutines(dll, NULL, CallEntries, NULL, NULL);
     R_useDynamicSymbols(dll, FALSE);
+    init_altrep_classes(dll);
 }
@@ -0,0 +1,348 @@
+/* qs - Quick Serialization of R Objects
+ Copyright (C) 2019-present Travers Ching
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+ You can contact the author at:
+ https://github.com/qsbase/qs
+ */
+
+#ifndef QS_ALTREP_H
+#define QS_ALTREP_H
+
+#include "qs_common.h"
+
+////////////////////////////////////////////////////////////////
+// lazy vectors: numeric, integer, logical and raw vectors backed by a qs file
+// data1 is an external pointer to LazyVectorData, data2 is the materialized vector (R_NilValue until first access)
+// materialization seeks to the start of the vector using the block index and decompresses only the blocks it covers
+////////////////////////////////////////////////////////////////
+
+// absolute path, so that lazy vectors can still be read after the working directory changes
+inline std::string full_path(const std::string & file) {
+  std::string path = R_ExpandFileName(file.c_str());
+#ifdef _WIN32
+  char * resolved = _fullpath(nullptr, path.c_str(), 0);
+#else
+  char * resolved = realpath(path.c_str(), nullptr);
+#endif
+  if(resolved == nullptr) return path;
+  std::string ret(resolved);
+  free(resolved);
+  return ret;
+}
+
+#ifdef USE_ALT_REP
+#include <R_ext/Altrep.h>
+
+struct LazyVectorData {
+  std::shared_ptr<const LazyFile> lazy_file;
+  uint64_t offset; // decompressed offset of the vector data
+  SEXPTYPE type;
+  uint64_t length;
+  bool shuffle;
+};
+
+static R_altrep_class_t lazy_real_class;
+static R_altrep_class_t lazy_integer_class;
+static R_altrep_class_t lazy_logical_class;
+static R_altrep_class_t lazy_raw_class;
+
+inline uint64_t lazy_bytesoftype(const SEXPTYPE type) {
+  switch(type) {
+  case REALSXP:
+    return 8;
+  case INTSXP:
+  case LGLSXP:
+    return 4;
+  default:
+    return 1;
+  }
+}
+
+inline char * lazy_dataptr(SEXP x) {
+  switch(TYPEOF(x)) {
+  case REALSXP:
+    return reinterpret_cast<char*>(REAL(x));
+  case INTSXP:
+    return reinterpret_cast<char*>(INTEGER(x));
+  case LGLSXP:
+    return reinterpret_cast<char*>(LOGICAL(x));
+  default:
+    return reinterpret_cast<char*>(RAW(x));
+  }
+}
+
+inline LazyVectorData * lazy_data(SEXP x) {
+  return reinterpret_cast<LazyVectorData*>(R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+
+static void lazy_finalizer(SEXP ptr) {
+  LazyVectorData * ld = reinterpret_cast<LazyVectorData*>(R_ExternalPtrAddr(ptr));
+  if(ld != nullptr) {
+    delete ld;
+    R_ClearExternalPtr(ptr);
+  }
+}
+
+template <class decompress_env>
+void read_lazy_data(const LazyVectorData & ld, char * outp) {
+  ld.lazy_file->checkUnchanged();
+  std::ifstream myFile(ld.lazy_file->file.c_str(), std::ios::in | std::ios::binary);
+  if(!myFile) {
+    throw std::runtime_error("For file " + ld.lazy_file->file + ": lazy vector could not be read, was the file moved or deleted?");
+  }
+  myFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  uint64_t bytesoftype = lazy_bytesoftype(ld.type);
+  Data_Context<std::ifstream, decompress_env> dc(myFile, ld.lazy_file->qm, false);
+  dc.seekOffset(ld.lazy_file->bi, ld.offset);
+  if(ld.shuffle) {
+    dc.getShuffleBlockData(outp, ld.length * bytesoftype, bytesoftype);
+  } else {
+    dc.getBlockData(outp, ld.length * bytesoftype);
+  }
+}
+
+// C++ exceptions can't propagate through ALTREP methods; convert to an R error once all C++ objects are destroyed
+static SEXP lazy_materialize(SEXP x) {
+  SEXP data2 = R_altrep_data2(x);
+  if(data2 != R_NilValue) return data2;
+  const LazyVectorData * ld = lazy_data(x);
+  SEXP obj = PROTECT(Rf_allocVector(ld->type, ld->length));
+  char * outp = lazy_dataptr(obj);
+  std::array<char, 512> error_msg = {};
+  try {
+    if(ld->lazy_file->qm.compress_algorithm == 0) {
+      read_lazy_data<zstd_decompress_env>(*ld, outp);
+    } else {
+      read_lazy_data<lz4_decompress_env>(*ld, outp);
+    }
+  } catch(std::exception & e) {
+    std::strncpy(error_msg.data(), e.what(), error_msg.size() - 1);
+  }
+  if(error_msg[0] != '\0') {
+    UNPROTECT(1);
+    Rf_error("%s", error_msg.data());
+  }
+  R_set_altrep_data2(x, obj);
+  UNPROTECT(1);
+  return obj;
+}
+
+static R_xlen_t lazy_Length(SEXP x) {
+  return static_cast<R_xlen_t>(lazy_data(x)->length);
+}
+
+static Rboolean lazy_Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int)) {
+  const LazyVectorData * ld = lazy_data(x);
+  Rprintf("qs lazy vector (len=%.0f, offset=%.0f, %s)\n", static_cast<double>(ld->length), static_cast<double>(ld->offset),
+          R_altrep_data2(x) == R_NilValue ? "not materialized" : "materialized");
+  return TRUE;
+}
+
+static void * lazy_Dataptr(SEXP x, Rboolean writeable) {
+  return lazy_dataptr(lazy_materialize(x));
+}
+
+static const void * lazy_Dataptr_or_null(SEXP x) {
+  SEXP data2 = R_altrep_data2(x);
+  return data2 == R_NilValue ? nullptr : lazy_dataptr(data2);
+}
+
+static double lazy_real_Elt(SEXP x, R_xlen_t i) {
+  return REAL(lazy_materialize(x))[i];
+}
+
+static int lazy_integer_Elt(SEXP x, R_xlen_t i) {
+  return INTEGER(lazy_materialize(x))[i];
+}
+
+static int lazy_logical_Elt(SEXP x, R_xlen_t i) {
+  return LOGICAL(lazy_materialize(x))[i];
+}
+
+static Rbyte lazy_raw_Elt(SEXP x, R_xlen_t i) {
+  return RAW(lazy_materialize(x))[i];
+}
+
+// Serialized_state is not defined, so base R serialization (and qsave) writes the materialized data
+inline void set_lazy_methods(R_altrep_class_t cls) {
+  R_set_altrep_Length_method(cls, lazy_Length);
+  R_set_altrep_Inspect_method(cls, lazy_Inspect);
+  R_set_altvec_Dataptr_method(cls, lazy_Dataptr);
+  R_set_altvec_Dataptr_or_null_method(cls, lazy_Dataptr_or_null);
+}
+
+////////////////////////////////////////////////////////////////
+// mmap views: numeric, integer, logical and raw vectors pointing directly into a memory mapped uncompressed file
+// data1 is an external pointer to MmapViewData; the map is private (copy on write), so writes through DATAPTR stay local
+////////////////////////////////////////////////////////////////
+
+struct MmapViewData {
+  std::shared_ptr<const MmapFile> mmap_file;
+  char * data;
+  uint64_t length;
+};
+
+static R_altrep_class_t mmap_real_class;
+static R_altrep_class_t mmap_integer_class;
+static R_altrep_class_t mmap_logical_class;
+static R_altrep_class_t mmap_raw_class;
+
+inline MmapViewData * mmap_data(SEXP x) {
+  return reinterpret_cast<MmapViewData*>(R_ExternalPtrAddr(R_altrep_data1(x)));
+}
+
+static void mmap_finalizer(SEXP ptr) {
+  MmapViewData * md = reinterpret_cast<MmapViewData*>(R_ExternalPtrAddr(ptr));
+  if(md != nullptr) {
+    delete md;
+    R_ClearExternalPtr(ptr);
+  }
+}
+
+static R_xlen_t mmap_Length(SEXP x) {
+  return static_cast<R_xlen_t>(mmap_data(x)->length);
+}
+
+static Rboolean mmap_Inspect(SEXP x, int pre, int deep, int pvec, void (*inspect_subtree)(SEXP, int, int, int)) {
+  const MmapViewData * md = mmap_data(x);
+  Rprintf("qs mmap view (len=%.0f, offset=%.0f)\n", static_cast<double>(md->length), static_cast<double>(md->data - md->mmap_file->map));
+  return TRUE;
+}
+
+static void * mmap_Dataptr(SEXP x, Rboolean writeable) {
+  return mmap_data(x)->data;
+}
+
+static const void * mmap_Dataptr_or_null(SEXP x) {
+  return mmap_data(x)->data;
+}
+
+static double mmap_real_Elt(SEXP x, R_xlen_t i) {
+  return reinterpret_cast<double*>(mmap_data(x)->data)[i];
+}
+
+static int mmap_integer_Elt(SEXP x, R_xlen_t i) {
+  return reinterpret_cast<int*>(mmap_data(x)->data)[i];
+}
+
+static Rbyte mmap_raw_Elt(SEXP x, R_xlen_t i) {
+  return reinterpret_cast<Rbyte*>(mmap_data(x)->data)[i];
+}
+
+inline void set_mmap_methods(R_altrep_class_t cls) {
+  R_set_altrep_Length_method(cls, mmap_Length);
+  R_set_altrep_Inspect_method(cls, mmap_Inspect);
+  R_set_altvec_Dataptr_method(cls, mmap_Dataptr);
+  R_set_altvec_Dataptr_or_null_method(cls, mmap_Dataptr_or_null);
+}
+
+void make_altrep_classes(DllInfo* dll) {
+  lazy_real_class = R_make_altreal_class("qs_lazy_real", "qs", dll);
+  set_lazy_methods(lazy_real_class);
+  R_set_altreal_Elt_method(lazy_real_class, lazy_real_Elt);
+  lazy_integer_class = R_make_altinteger_class("qs_lazy_integer", "qs", dll);
+  set_lazy_methods(lazy_integer_class);
+  R_set_altinteger_Elt_method(lazy_integer_class, lazy_integer_Elt);
+  lazy_logical_class = R_make_altlogical_class("qs_lazy_logical", "qs", dll);
+  set_lazy_methods(lazy_logical_class);
+  R_set_altlogical_Elt_method(lazy_logical_class, lazy_logical_Elt);
+  lazy_raw_class = R_make_altraw_class("qs_lazy_raw", "qs", dll);
+  set_lazy_methods(lazy_raw_class);
+  R_set_altraw_Elt_method(lazy_raw_class, lazy_raw_Elt);
+
+  mmap_real_class = R_make_altreal_class("qs_mmap_real", "qs", dll);
+  set_mmap_methods(mmap_real_class);
+  R_set_altreal_Elt_method(mmap_real_class, mmap_real_Elt);
+  mmap_integer_class = R_make_altinteger_class("qs_mmap_integer", "qs", dll);
+  set_mmap_methods(mmap_integer_class);
+  R_set_altinteger_Elt_method(mmap_integer_class, mmap_integer_Elt);
+  mmap_logical_class = R_make_altlogical_class("qs_mmap_logical", "qs", dll);
+  set_mmap_methods(mmap_logical_class);
+  R_set_altlogical_Elt_method(mmap_logical_class, mmap_integer_Elt);
+  mmap_raw_class = R_make_altraw_class("qs_mmap_raw", "qs", dll);
+  set_mmap_methods(mmap_raw_class);
+  R_set_altraw_Elt_method(mmap_raw_class, mmap_raw_Elt);
+}
+
+SEXP make_lazy_vector(const std::shared_ptr<const LazyFile> & lazy_file, const uint64_t offset,
+                      const SEXPTYPE type, const uint64_t length, const bool shuffle) {
+  SEXP ptr = PROTECT(R_MakeExternalPtr(new LazyVectorData{lazy_file, offset, type, length, shuffle}, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(ptr, lazy_finalizer, TRUE);
+  SEXP ret;
+  switch(type) {
+  case REALSXP:
+    ret = R_new_altrep(lazy_real_class, ptr, R_NilValue);
+    break;
+  case INTSXP:
+    ret = R_new_altrep(lazy_integer_class, ptr, R_NilValue);
+    break;
+  case LGLSXP:
+    ret = R_new_altrep(lazy_logical_class, ptr, R_NilValue);
+    break;
+  default:
+    ret = R_new_altrep(lazy_raw_class, ptr, R_NilValue);
+    break;
+  }
+  UNPROTECT(1);
+  return ret;
+}
+
+SEXP make_mmap_view(const std::shared_ptr<const MmapFile> & mmap_file, char * const data,
+                    const SEXPTYPE type, const uint64_t length) {
+  SEXP ptr = PROTECT(R_MakeExternalPtr(new MmapViewData{mmap_file, data, length}, R_NilValue, R_NilValue));
+  R_RegisterCFinalizerEx(ptr, mmap_finalizer, TRUE);
+  SEXP ret;
+  switch(type) {
+  case REALSXP:
+    ret = R_new_altrep(mmap_real_class, ptr, R_NilValue);
+    break;
+  case INTSXP:
+    ret = R_new_altrep(mmap_integer_class, ptr, R_NilValue);
+    break;
+  case LGLSXP:
+    ret = R_new_altrep(mmap_logical_class, ptr, R_NilValue);
+    break;
+  default:
+    ret = R_new_altrep(mmap_raw_class, ptr, R_NilValue);
+    break;
+  }
+  UNPROTECT(1);
+  return ret;
+}
+
+#else
+
+SEXP make_lazy_vector(const std::shared_ptr<const LazyFile> & lazy_file, const uint64_t offset,
+                      const SEXPTYPE type, const uint64_t length, const bool shuffle) {
+  throw std::runtime_error("lazy vectors are not available in R < 3.5");
+}
+
+// views are only created with ALTREP; without it vectors are copied out of the map
+SEXP make_mmap_view(const std::shared_ptr<const MmapFile> & mmap_file, char * const data,
+                    const SEXPTYPE type, const uint64_t length) {
+  return R_NilValue;
+}
+
+#endif
+
+// [[Rcpp::init]]
+void init_altrep_classes(DllInfo* dll) {
+#ifdef USE_ALT_REP
+  make_altrep_classes(dll);
+#endif
+}
+
+#endif
@@ -25,6 +25,7 @@ https://github.com/qsbase/qs
 
 #include <fstream>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
 #include <unistd.h>
@@ -39,8 +40,14 @@ https://github.com/qsbase/qs
 #include <vector>
 #include <climits>
 #include <cstdint>
+#include <cmath>
 #include <unordered_map>
 #include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
 #include <boost/functional/hash.hpp> // hash for altrep_registry
 
 // platform specific headers
@@ -59,6 +66,7 @@ https://github.com/qsbase/qs
 #endif
 #else
 #include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
 #endif
 
 #include <atomic>
@@ -71,6 +79,12 @@ https://github.com/qsbase/qs
 #include "RApiSerializeAPI.h"
 
 #include "zstd.h"
+// the dictionary builder is part of the zstd library, but zdict.h is not among the bundled headers
+extern "C" {
+size_t ZDICT_trainFromBuffer(void* dictBuffer, size_t dictBufferCapacity, const void* samplesBuffer, const size_t* samplesSizes, unsigned nbSamples);
+unsigned ZDICT_isError(size_t errorCode);
+const char* ZDICT_getErrorName(size_t errorCode);
+}
 #include "lz4.h"
 #include "lz4hc.h"
 #include "BLOSC/shuffle_routines.h"
@@ -104,8 +118,12 @@ inline constexpr unsigned char operator ""_u16(unsigned long long arg) noexcept
 
 static constexpr uint64_t BLOCKRESERVE = 64ULL;
 static constexpr uint32_t NA_STRING_LENGTH = 4294967295UL; // 2^32-1 -- length used to signify NA value; note maximum string size is defined by `int` in mkCharLen, so this value is safe
+static constexpr uint32_t STRING_REF_BIT = 0x80000000UL; // set in the string length read for a back-reference, the rest is the distance back in the string table
+static constexpr uint32_t MAX_STRING_REF = 0x7FFFFFFEUL; // largest distance of a back-reference, so that it can't be confused with NA_STRING_LENGTH
 static constexpr uint64_t MIN_SHUFFLE_ELEMENTS = 4ULL;
-static constexpr uint64_t BLOCKSIZE = 524288ULL;
+static constexpr uint64_t BLOCKSIZE = 524288ULL; // default block size, see QsMetadata::block_size
+static constexpr uint64_t MIN_BLOCKSIZE = 4096ULL;
+static constexpr uint64_t MAX_BLOCKSIZE = 16777216ULL;
 static constexpr uint64_t MAX_SAFE_INTEGER = 9007199254740991ULL; // 2^53-1 -- the largest integer that can be "safely" represented as a double ~ (about 9000 terabytes)
 
 static const std::array<uint8_t,4> magic_bits = {0x0B,0x0E,0x0A,0x0C};
@@ -153,6 +171,11 @@ static constexpr uint8_t string_header_8 = 0x01_u8;
 static constexpr uint8_t string_header_16 = 0x02_u8;
 static constexpr uint8_t string_header_32 = 0x03_u8;
 
+// back-reference to an earlier string of a character vector (see string_dedup_flag), followed by the distance back in the string table
+static constexpr uint8_t string_header_ref_8 = 0x04_u8;
+static constexpr uint8_t string_header_ref_16 = 0x05_u8;
+static constexpr uint8_t string_header_ref_32 = 0x06_u8;
+
 static constexpr uint8_t string_enc_native = 0x00_u8;
 static constexpr uint8_t string_enc_utf8 = 0x40_u8;
 static constexpr uint8_t string_enc_latin1 = 0x80_u8;
@@ -194,6 +217,12 @@ static constexpr uint8_t clos_wf_header = 0x13_u8;
 static constexpr uint8_t prom_wf_header = 0x14_u8;
 static constexpr uint8_t dot_wf_header = 0x15_u8;
 
+// low cardinality character vector: the distinct strings followed by the code of each element (see CharacterDictionary)
+static constexpr uint8_t character_dict_header = 0x16_u8;
+// character vector with the lengths of all strings followed by their bytes concatenated (see writeCharacterColumnar)
+static constexpr uint8_t character_columnar_header = 0x17_u8;
+static constexpr uint8_t COLUMNAR_MIXED_ENCODINGS = 0xFF_u8; // in place of the common encoding, an encoding per string follows the lengths
+
 
 
 // static constexpr std::array<uint8_t,2> s4_header_with_ext {{ extension_header, s4_header }};
@@ -223,7 +252,8 @@ static constexpr uint8_t dot_wf_header = 0x15_u8;
 enum class qstype {NUMERIC, INTEGER, LOGICAL, CHARACTER, NIL, LIST, COMPLEX, RAW, PAIRLIST, LANG, CLOS, PROM, DOT, SYM,
                    PAIRLIST_WF, LANG_WF, CLOS_WF, PROM_WF, DOT_WF, // with flags
                    S4, S4FLAG, LOCKED_ENV, UNLOCKED_ENV, REFERENCE,
-                   ATTRIBUTE, RSERIALIZED};
+                   ATTRIBUTE, RSERIALIZED,
+                   CHARACTER_DICT, CHARACTER_COLUMNAR};
 
 // global variable to trust promises for both serialization and de-serialization
 static bool trust_promises_global = false;
@@ -486,6 +516,42 @@ inline bool isSeekable(mem_wrapper & myFile) {
   return false;
 }
 
+// private, copy on write memory map of a whole file
+// unmapped when the last reference (reader or ALTREP view, see qs_altrep.h) is released
+struct MmapFile {
+  char * map = nullptr;
+  uint64_t length = 0;
+  MmapFile(const std::string & file) {
+#ifdef _WIN32
+    throw std::runtime_error("mmap not available on windows");
+#else
+    int fd = open(file.c_str(), O_RDONLY);
+    if(fd == -1) throw std::runtime_error("error creating file descriptor");
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+      close(fd);
+      throw std::runtime_error("error reading file size");
+    }
+    length = static_cast<uint64_t>(st.st_size);
+    if(length > 0) {
+      void * m = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      close(fd);
+      if(m == MAP_FAILED) throw std::runtime_error("error memory mapping file");
+      map = static_cast<char*>(m);
+    } else {
+      close(fd);
+    }
+#endif
+  }
+  ~MmapFile() {
+#ifndef _WIN32
+    if(map != nullptr) munmap(map, length);
+#endif
+  }
+  MmapFile(const MmapFile &) = delete;
+  MmapFile & operator=(const MmapFile &) = delete;
+};
+
 ///////////////////////////////////////////////////////
 // helper functions for writing to std::vector
 // This is only used for writing
@@ -644,13 +710,39 @@ enum class compalg : uint8_t {
   zstd = 0, lz4 = 1, lz4hc = 2, zstd_stream = 3, uncompressed = 4
 };
 // qs reserve header details
+// reserve2[0] feature flags (format version 4): 0x01 = block index footer written after the hash (see BlockIndex)
+//                                              0x02 = element index written before the block index (see ElementIndex)
+//                                              0x04 = a zero length block follows the last block (block compression algorithms only),
+//                                                     the number of blocks is not known from the header when writing to a pipe or socket
+//                                              0x08 = blocks that do not compress are stored as is, marked by RAW_BLOCK_BIT in the block size
+//                                              0x10 = zstd blocks are compressed with a dictionary, the frame header of each block has its ID
+//                                                     (see ZstdDictionary)
+//                                              0x20 = an XXH3 64 bit hash of the uncompressed block follows the size of each block, replaces the hash
+//                                                     of the whole object (see blockHash)
+//                                              0x40 = repeated strings of character vectors are written as back-references to their first occurrence
+//                                                     (see StringRefMap and StringTable)
+// reserve2[1] block size (format version 4, block compression algorithms only): log2 of the uncompressed block size, 0 = BLOCKSIZE
+// reserve2[2] alignment (format version 4, uncompressed only): log2 of the file offset alignment of large numeric payloads, 0 = not aligned
+// reserve2[3] window log (format version 4, zstd_stream only): log2 of the zstd window size, 0 = default for the compression level
 // reserve[0] format version (start writing and checking in qs 0.20.1)
 // reserve[1] (low byte) 1 = hash of serialized object written to last 4 bytes of file -- before 16.3, no hash check was performed
 // reserve[1] (high byte) unused
 // reserve[2] (low byte) shuffle control: 0x01 = logical shuffle, 0x02 = integer shuffle, 0x04 = double shuffle
 // reserve[2] (high byte) algorithm: 0x01 = lz4, 0x00 = zstd, 0x02 = "lz4hc", 0x03 = zstd_stream
 // reserve[3] endian: 1 = big endian, 0 = little endian
-static constexpr int CURRENT_FORMAT_VER = 3;
+static constexpr int CURRENT_FORMAT_VER = 4;
+static constexpr int LEGACY_FORMAT_VER = 3; // written when no format version 4 feature is used, so that older versions of qs read the file as before
+static constexpr uint8_t block_index_flag = 0x01_u8;
+static constexpr uint8_t element_index_flag = 0x02_u8;
+static constexpr uint8_t block_sentinel_flag = 0x04_u8;
+static constexpr uint8_t raw_block_flag = 0x08_u8;
+static constexpr uint8_t dictionary_flag = 0x10_u8;
+static constexpr uint8_t block_hash_flag = 0x20_u8;
+static constexpr uint8_t string_dedup_flag = 0x40_u8;
+static constexpr uint64_t MMAP_ALIGNMENT = 64ULL; // alignment used by the "mmap" preset
+static constexpr uint64_t MIN_ALIGN_BYTES = 4096ULL; // smaller payloads are not padded, bounding the overhead to 1.5%
+static constexpr uint64_t MIN_MMAP_VIEW_BYTES = 524288ULL; // smaller vectors are copied by qread_mmap, a view is not worth its ALTREP overhead
+static constexpr int ARCHIVE_LONG_WINDOW_LOG = 27; // 128 MiB, the largest window zstd decompresses without ZSTD_d_windowLogMax
 struct QsMetadata {
   uint64_t clength; // compressed length -- for comparing bytes_read / blocks_read with recorded # ..
   bool check_hash;
@@ -662,10 +754,39 @@ struct QsMetadata {
   bool int_shuffle;
   bool real_shuffle;
   bool cplx_shuffle;
+  bool block_index;
+  bool element_index;
+  bool block_sentinel; // set by the writer, see block_sentinel_flag
+  uint64_t alignment; // 0 = payloads are not padded
+  uint64_t block_size; // uncompressed size of a full block, a power of 2 between MIN_BLOCKSIZE and MAX_BLOCKSIZE
+  bool raw_blocks; // see raw_block_flag
+  bool dictionary; // see dictionary_flag
+  bool block_hash; // see block_hash_flag
+  bool string_dedup; // see string_dedup_flag
+  bool string_dict; // writer only, low cardinality character vectors are written as CHARACTER_DICT
+  bool string_columnar; // writer only, other long character vectors are written as CHARACTER_COLUMNAR
+  uint32_t dict_id; // writer only, the ID of the dictionary used for compression or 0
+  int window_log; // zstd_stream only, 0 = default window size for the compression level
+  bool long_distance_matching; // writer only, zstd_stream only
+
+  static bool validBlockSize(const uint64_t block_size) {
+    return block_size >= MIN_BLOCKSIZE && block_size <= MAX_BLOCKSIZE && (block_size & (block_size - 1)) == 0;
+  }
+  // zstd, lz4 and lz4hc compress independent blocks, zstd_stream and uncompressed are streams
+  bool blockAlgorithm() const {
+    return compress_algorithm == static_cast<uint8_t>(compalg::zstd) ||
+           compress_algorithm == static_cast<uint8_t>(compalg::lz4) ||
+           compress_algorithm == static_cast<uint8_t>(compalg::lz4hc);
+  }
 
   //constructor from qsave
-  QsMetadata(const std::string & preset, const std::string & algorithm, const int compress_level, int shuffle_control, const bool check_hash) :
-    clength(0), check_hash(check_hash), endian(is_big_endian()) {
+  QsMetadata(const std::string & preset, const std::string & algorithm, const int compress_level, int shuffle_control, const bool check_hash,
+             const uint64_t block_size = BLOCKSIZE, const bool block_hash = false, const bool string_dedup = false,
+             const bool block_index = false, const bool raw_blocks = false, const bool string_dict = false,
+             const bool string_columnar = false) :
+    clength(0), check_hash(check_hash), endian(is_big_endian()), block_sentinel(false), alignment(0), block_size(BLOCKSIZE), raw_blocks(false), dictionary(false),
+    block_hash(false), string_dedup(string_dedup), string_dict(string_dict), string_columnar(false), dict_id(0),
+    window_log(0), long_distance_matching(false) {
     if(preset == "fast") {
       compress_algorithm = static_cast<uint8_t>(compalg::lz4);
       this->compress_level = 100;
@@ -682,10 +803,22 @@ struct QsMetadata {
       compress_algorithm = static_cast<uint8_t>(compalg::zstd_stream);
       this->compress_level = 14;
       shuffle_control = 15;
+    } else if(preset == "archive_long") {
+      // long distance matching finds repeats that are far apart, e.g. in lists of similar data.frames
+      compress_algorithm = static_cast<uint8_t>(compalg::zstd_stream);
+      this->compress_level = 14;
+      shuffle_control = 15;
+      window_log = ARCHIVE_LONG_WINDOW_LOG;
+      long_distance_matching = true;
     } else if(preset == "uncompressed") {
       compress_algorithm = static_cast<uint8_t>(compalg::uncompressed);
       this->compress_level = 0;
       shuffle_control = 0;
+    } else if(preset == "mmap") {
+      compress_algorithm = static_cast<uint8_t>(compalg::uncompressed);
+      this->compress_level = 0;
+      shuffle_control = 0;
+      alignment = MMAP_ALIGNMENT;
     } else if(preset == "custom") {
       if(algorithm == "zstd") {
         compress_algorithm = static_cast<uint8_t>(compalg::zstd);
@@ -710,7 +843,7 @@ struct QsMetadata {
         throw std::runtime_error("algorithm must be one of zstd, lz4, lz4hc or zstd_stream");
       }
     } else {
-      throw std::runtime_error("preset must be one of fast, balanced (default), high, archive or custom");
+      throw std::runtime_error("preset must be one of fast, balanced (default), high, archive, archive_long, uncompressed, mmap or custom");
     }
     if(shuffle_control < 0 || shuffle_control > 15) throw std::runtime_error("shuffle_control must be an integer between 0 and 15");
     lgl_shuffle = shuffle_control & 0x01;
@@ -718,6 +851,25 @@ struct QsMetadata {
     real_shuffle = shuffle_control & 0x04;
     cplx_shuffle = shuffle_control & 0x08;
     format_version = CURRENT_FORMAT_VER;
+    // the block index footer is optional, older versions of qs don't expect data after the hash
+    // it is only meaningful for block compression algorithms
+    this->block_index = block_index && blockAlgorithm();
+    element_index = this->block_index;
+    // stream algorithms are not split into blocks
+    if(blockAlgorithm()) {
+      if(!validBlockSize(block_size)) throw std::runtime_error("block_size must be a power of 2 between " + std::to_string(MIN_BLOCKSIZE) +
+                                                               " and " + std::to_string(MAX_BLOCKSIZE));
+      this->block_size = block_size;
+    }
+    // older versions of qs can't read blocks stored as is, so this is opt-in
+    this->raw_blocks = raw_blocks && blockAlgorithm();
+    // see MIN_COLUMNAR_LENGTH, uncompressed output keeps a header per string
+    this->string_columnar = string_columnar && compress_algorithm != static_cast<uint8_t>(compalg::uncompressed);
+    // the hash of each block is computed by the compression threads, the serial hash of the whole object is not needed
+    if(block_hash && blockAlgorithm()) {
+      this->block_hash = true;
+      this->check_hash = false;
+    }
   }
 
   // 0x0B0E0A0C
@@ -738,21 +890,33 @@ struct QsMetadata {
              const bool lgl_shuffle,
              const bool int_shuffle,
              const bool real_shuffle,
-             const bool cplx_shuffle) :
+             const bool cplx_shuffle,
+             const bool block_index,
+             const bool element_index,
+             const bool block_sentinel,
+             const uint64_t alignment,
+             const uint64_t block_size,
+             const bool raw_blocks,
+             const bool dictionary,
+             const bool block_hash,
+             const bool string_dedup,
+             const int window_log) :
     clength(clength), check_hash(check_hash), endian(endian), compress_algorithm(compress_algorithm),
     compress_level(compress_level), format_version(format_version), lgl_shuffle(lgl_shuffle), int_shuffle(int_shuffle),
-    real_shuffle(real_shuffle), cplx_shuffle(cplx_shuffle) {}
+    real_shuffle(real_shuffle), cplx_shuffle(cplx_shuffle), block_index(block_index), element_index(element_index),
+    block_sentinel(block_sentinel), alignment(alignment), block_size(block_size), raw_blocks(raw_blocks),
+    dictionary(dictionary), block_hash(block_hash), string_dedup(string_dedup), string_dict(false), string_columnar(false), dict_id(0), window_log(window_log), long_distance_matching(false) {}
 
   // constructor from q_read
   template <class stream_reader>
   static QsMetadata create(stream_reader & myFile) {
     std::array<uint8_t,4> reserve_bits;
+    std::array<uint8_t,4> reserve_bits2 = {0,0,0,0};
     read_check(myFile, reinterpret_cast<char*>(reserve_bits.data()),4);
     // version 2
     if(reserve_bits[0] != 0) {
-      std::array<uint8_t,4> reserve_bits2;
       if(!checkMagicNumber(reserve_bits)) throw std::runtime_error("QS format not detected");
-      read_check(myFile, reinterpret_cast<char*>(reserve_bits2.data()),4); // empty reserve bits for now
+      read_check(myFile, reinterpret_cast<char*>(reserve_bits2.data()),4); // feature flags, empty before format version 4
       read_check(myFile, reinterpret_cast<char*>(reserve_bits.data()),4);
     }
     uint8_t sys_endian = is_big_endian() ? 0x01 : 0x00;
@@ -767,6 +931,20 @@ struct QsMetadata {
     bool check_hash = reserve_bits[1];
     uint8_t endian = reserve_bits[3];
     int format_version = reserve_bits[0];
+    bool block_index = format_version >= 4 && (reserve_bits2[0] & block_index_flag);
+    bool element_index = format_version >= 4 && (reserve_bits2[0] & element_index_flag);
+    bool block_sentinel = format_version >= 4 && (reserve_bits2[0] & block_sentinel_flag);
+    if(reserve_bits2[2] > 30) throw std::runtime_error("invalid alignment in header");
+    uint64_t alignment = (format_version >= 4 && reserve_bits2[2] > 0) ? (1ULL << reserve_bits2[2]) : 0;
+    uint64_t block_size = (format_version >= 4 && reserve_bits2[1] > 0 && reserve_bits2[1] < 64) ? (1ULL << reserve_bits2[1]) : BLOCKSIZE;
+    if(!validBlockSize(block_size)) throw std::runtime_error("invalid block size in header");
+    bool raw_blocks = format_version >= 4 && (reserve_bits2[0] & raw_block_flag);
+    bool dictionary = format_version >= 4 && (reserve_bits2[0] & dictionary_flag);
+    bool block_hash = format_version >= 4 && (reserve_bits2[0] & block_hash_flag);
+    bool string_dedup = format_version >= 4 && (reserve_bits2[0] & string_dedup_flag);
+    int window_log = format_version >= 4 ? reserve_bits2[3] : 0;
+    ZSTD_bounds window_bounds = ZSTD_cParam_getBounds(ZSTD_c_windowLog); // ZSTD_WINDOWLOG_MAX is not part of the stable API
+    if(window_log != 0 && (window_log < window_bounds.lowerBound || window_log > window_bounds.upperBound)) throw std::runtime_error("invalid window size in header");
     uint64_t clength = readSize8(myFile);
     return {clength,
             check_hash,
@@ -777,16 +955,38 @@ struct QsMetadata {
             lgl_shuffle,
             int_shuffle,
             real_shuffle,
-            cplx_shuffle};
+            cplx_shuffle,
+            block_index,
+            element_index,
+            block_sentinel,
+            alignment,
+            block_size,
+            raw_blocks,
+            dictionary,
+            block_hash,
+            string_dedup,
+            window_log};
   }
 
   // version 2
   template <class stream_writer>
   void writeToFile(stream_writer & myFile) {
     write_check(myFile, reinterpret_cast<const char*>(magic_bits.data()), 4);
-    write_check(myFile, reinterpret_cast<const char*>(empty_bits.data()),4);
+    std::array<uint8_t,4> reserve_bits2 = {0,0,0,0};
+    reserve_bits2[0] = (block_index ? block_index_flag : 0) | (element_index ? element_index_flag : 0) |
+                       (block_sentinel ? block_sentinel_flag : 0) | (raw_blocks ? raw_block_flag : 0) |
+                       (dictionary ? dictionary_flag : 0) | (block_hash ? block_hash_flag : 0) |
+                       (string_dedup ? string_dedup_flag : 0);
+    if(block_size != BLOCKSIZE) {
+      for(uint64_t b = block_size; b > 1; b >>= 1) reserve_bits2[1]++;
+    }
+    for(uint64_t a = alignment; a > 1; a >>= 1) reserve_bits2[2]++;
+    reserve_bits2[3] = static_cast<uint8_t>(window_log);
+    write_check(myFile, reinterpret_cast<char*>(reserve_bits2.data()),4);
     std::array<uint8_t,4> reserve_bits = {0,0,0,0};
-    reserve_bits[0] = static_cast<uint8_t>(format_version);
+    // the string encodings have no header flag, older versions of qs only learn about them from the format version
+    bool format_4 = reserve_bits2 != std::array<uint8_t,4>{{0,0,0,0}} || string_dict || string_columnar;
+    reserve_bits[0] = static_cast<uint8_t>(format_4 ? format_version : LEGACY_FORMAT_VER);
     reserve_bits[1] = check_hash;
     reserve_bits[2] += compress_algorithm << 4;
     reserve_bits[3] = is_big_endian() ? 0x01 : 0x00;
@@ -795,6 +995,156 @@ struct QsMetadata {
   }
 };
 
+// number of zero bytes written before a numeric, integer, logical or complex payload of data_size bytes
+// so that the payload starts on a multiple of qm.alignment; file_offset is the offset of the payload from the start of the file
+inline uint64_t alignmentPadding(const QsMetadata & qm, const uint64_t file_offset, const uint64_t data_size) {
+  if(qm.alignment == 0 || data_size < MIN_ALIGN_BYTES) return 0;
+  return (qm.alignment - file_offset % qm.alignment) % qm.alignment;
+}
+
+// block index footer (format version 4, block compression algorithms only)
+// written after the hash so that a reader can seek directly to block N instead of decompressing sequentially
+// [number of blocks:8] [file offset:8][decompressed offset:8] x number of blocks [decompressed length:8] [number of blocks:8]
+// file offsets are relative to the start of the qs header and point to the [zsize:4] of each block
+// the number of blocks is repeated at the end so that the footer can also be located from the end of a seekable file
+static constexpr uint64_t QS_HEADER_LENGTH = 20ULL; // magic bits (4) + reserve2 (4) + reserve (4) + clength (8)
+struct BlockIndex {
+  std::vector<uint64_t> file_offsets;
+  std::vector<uint64_t> decompressed_offsets;
+  uint64_t decompressed_length = 0;
+
+  uint64_t size() const {
+    return file_offsets.size();
+  }
+  uint64_t footerSize() const {
+    return 24 + 16 * size();
+  }
+  void push_back(const uint64_t file_offset, const uint64_t block_size) {
+    file_offsets.push_back(file_offset);
+    decompressed_offsets.push_back(decompressed_length);
+    decompressed_length += block_size;
+  }
+  // block containing the decompressed byte at offset
+  uint64_t findBlock(const uint64_t offset) const {
+    if(offset >= decompressed_length) throw std::runtime_error("offset is beyond the end of the decompressed data");
+    auto it = std::upper_bound(decompressed_offsets.begin(), decompressed_offsets.end(), offset);
+    return static_cast<uint64_t>(it - decompressed_offsets.begin()) - 1;
+  }
+  template <class stream_writer>
+  void writeToFile(stream_writer & myFile) const {
+    writeSize8(myFile, size());
+    for(uint64_t i=0; i<size(); i++) {
+      writeSize8(myFile, file_offsets[i]);
+      writeSize8(myFile, decompressed_offsets[i]);
+    }
+    writeSize8(myFile, decompressed_length);
+    writeSize8(myFile, size());
+  }
+  template <class stream_reader>
+  void readFromFile(stream_reader & myFile) {
+    uint64_t nblocks = readSize8(myFile);
+    file_offsets.resize(nblocks);
+    decompressed_offsets.resize(nblocks);
+    for(uint64_t i=0; i<nblocks; i++) {
+      file_offsets[i] = readSize8(myFile);
+      decompressed_offsets[i] = readSize8(myFile);
+    }
+    decompressed_length = readSize8(myFile);
+    if(readSize8(myFile) != nblocks) throw std::runtime_error("block index is corrupted");
+  }
+  // locate and read the footer from the end of a seekable file; file position is left undefined
+  // the number of blocks is checked against the file size before seeking, a corrupted tail is reported instead of allocated
+  void readFromEnd(std::ifstream & myFile) {
+    myFile.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(myFile.tellg());
+    if(file_size < QS_HEADER_LENGTH + 24) throw std::runtime_error("block index is corrupted");
+    myFile.seekg(-8, std::ios::end);
+    uint64_t nblocks = readSize8(myFile);
+    if(nblocks > (file_size - QS_HEADER_LENGTH - 24) / 16) throw std::runtime_error("block index is corrupted");
+    myFile.seekg(-static_cast<std::streamoff>(24 + 16 * nblocks), std::ios::end);
+    readFromFile(myFile);
+  }
+};
+
+// element index (format version 4, written directly before the block index)
+// decompressed offsets of each element of a top level list, followed by the offset of the list attributes
+// [number of offsets:8] [decompressed offset:8] x number of offsets [number of offsets:8]
+// number of offsets is zero if the object is not a list, or if elements can't be read independently (e.g. environment references)
+struct ElementIndex {
+  std::vector<uint64_t> offsets;
+
+  uint64_t size() const {
+    return offsets.size();
+  }
+  uint64_t footerSize() const {
+    return 16 + 8 * size();
+  }
+  // number of list elements; the last offset marks the start of the attributes
+  uint64_t elements() const {
+    return size() == 0 ? 0 : size() - 1;
+  }
+  template <class stream_writer>
+  void writeToFile(stream_writer & myFile) const {
+    writeSize8(myFile, size());
+    for(uint64_t i=0; i<size(); i++) {
+      writeSize8(myFile, offsets[i]);
+    }
+    writeSize8(myFile, size());
+  }
+  template <class stream_reader>
+  void readFromFile(stream_reader & myFile) {
+    uint64_t noffsets = readSize8(myFile);
+    offsets.resize(noffsets);
+    for(uint64_t i=0; i<noffsets; i++) {
+      offsets[i] = readSize8(myFile);
+    }
+    if(readSize8(myFile) != noffsets) throw std::runtime_error("element index is corrupted");
+  }
+  // the element index sits directly before the block index footer
+  void readFromEnd(std::ifstream & myFile, const BlockIndex & bi) {
+    myFile.seekg(0, std::ios::end);
+    uint64_t file_size = static_cast<uint64_t>(myFile.tellg());
+    if(file_size < QS_HEADER_LENGTH + bi.footerSize() + 16) throw std::runtime_error("element index is corrupted");
+    myFile.seekg(-static_cast<std::streamoff>(bi.footerSize() + 8), std::ios::end);
+    uint64_t noffsets = readSize8(myFile);
+    if(noffsets > (file_size - QS_HEADER_LENGTH - bi.footerSize() - 16) / 8) throw std::runtime_error("element index is corrupted");
+    myFile.seekg(-static_cast<std::streamoff>(bi.footerSize() + 16 + 8 * noffsets), std::ios::end);
+    readFromFile(myFile);
+  }
+};
+
+// shared state of vectors read lazily (qread(..., lazy = TRUE)); each vector keeps the file and its block index alive
+// the size and modification time of the file are recorded when it is read, lazy vectors check them before reading the file again
+struct LazyFile {
+  std::string file;
+  QsMetadata qm;
+  BlockIndex bi;
+  uint64_t file_size = 0;
+  int64_t mtime = 0;
+  LazyFile(const std::string & file, const QsMetadata & qm, const BlockIndex & bi) : file(file), qm(qm), bi(bi) {
+    if(!stamp(file_size, mtime)) throw std::runtime_error("For file " + file + ": could not read the file size and modification time");
+  }
+  bool stamp(uint64_t & size, int64_t & time) const {
+    struct stat st;
+    if(stat(file.c_str(), &st) != 0) return false;
+    size = static_cast<uint64_t>(st.st_size);
+    time = static_cast<int64_t>(st.st_mtime);
+    return true;
+  }
+  void checkUnchanged() const {
+    uint64_t size;
+    int64_t time;
+    if(!stamp(size, time)) throw std::runtime_error("For file " + file + ": lazy vector could not be read, was the file moved or deleted?");
+    if(size != file_size || time != mtime) throw std::runtime_error("For file " + file + ": lazy vector could not be read, the file was modified after it was read");
+  }
+};
+
+// defined in qs_altrep.h
+SEXP make_lazy_vector(const std::shared_ptr<const LazyFile> & lazy_file, const uint64_t offset,
+                      const SEXPTYPE type, const uint64_t length, const bool shuffle);
+SEXP make_mmap_view(const std::shared_ptr<const MmapFile> & mmap_file, char * const data,
+                    const SEXPTYPE type, const uint64_t length);
+
 // Normalize lz4/zstd function arguments so we can use function types
 using compress_fun = size_t (*)(void*, size_t, const void*, size_t, int);
 using decompress_fun = size_t (*)(void*, size_t, const void*, size_t);
@@ -845,6 +1195,15 @@ template <class stream_reader>
 uint32_t validate_data(const QsMetadata & qm, stream_reader & myFile, const uint32_t recorded_hash,
                        const uint32_t computed_hash, const uint64_t computed_length, const bool strict,
                        const std::string & file = "") {
+  // the element and block indices are only needed for random access; skip over them
+  if(qm.element_index) {
+    ElementIndex ei;
+    ei.readFromFile(myFile);
+  }
+  if(qm.block_index) {
+    BlockIndex bi;
+    bi.readFromFile(myFile);
+  }
   // destructively check EOF -- cannot putback data
   std::array<char,4> temp;
   uint64_t remaining_bytes = read_allow(myFile, temp.data(), 4);
@@ -968,17 +1327,121 @@ struct xxhash_env {
   }
 };
 
+// hash of the uncompressed data of a block (see block_hash_flag)
+// unlike xxhash_env it has no running state, so each block can be hashed by the thread that compresses or decompresses it
+inline uint64_t blockHash(const char * const data, const uint64_t len) {
+  return XXH3_64bits(data, len);
+}
+
+// block_number counts from 1
+inline void checkBlockHash(const char * const data, const uint64_t len, const uint64_t recorded_hash, const uint64_t block_number) {
+  uint64_t computed_hash = blockHash(data, len);
+  if(computed_hash != recorded_hash) {
+    throw std::runtime_error("Block hash does not match in block " + std::to_string(block_number) + " (Recorded, Computed) (" +
+                             std::to_string(recorded_hash) + "," + std::to_string(computed_hash) + "), data is corrupted");
+  }
+}
+
+////////////////////////////////////////////////////////////////
+// zstd dictionaries, for compressing many small objects
+// dictionaries are registered by their ID for the session; a file does not contain its dictionary, only the ID in each zstd frame
+////////////////////////////////////////////////////////////////
+
+struct ZstdDictionary {
+  std::vector<char> data;
+  ZSTD_DDict* ddict;
+  std::mutex mutex;
+  std::unordered_map<int, ZSTD_CDict*> cdicts; // digested for each compression level on first use
+  ZstdDictionary(const char * const dict, const uint64_t dict_size) : data(dict, dict + dict_size), ddict(ZSTD_createDDict(dict, dict_size)) {
+    if(ddict == nullptr) throw std::runtime_error("zstd dictionary allocation error");
+  }
+  ~ZstdDictionary() {
+    for(auto & c : cdicts) ZSTD_freeCDict(c.second);
+    ZSTD_freeDDict(ddict);
+  }
+  ZstdDictionary(const ZstdDictionary &) = delete;
+  ZstdDictionary & operator=(const ZstdDictionary &) = delete;
+  ZSTD_CDict* getCDict(const int compress_level) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cdicts.find(compress_level);
+    if(it != cdicts.end()) return it->second;
+    ZSTD_CDict* cdict = ZSTD_createCDict(data.data(), data.size(), compress_level);
+    if(cdict == nullptr) throw std::runtime_error("zstd dictionary allocation error");
+    cdicts.emplace(compress_level, cdict);
+    return cdict;
+  }
+};
+
+// looked up from worker threads while decompressing, so access is locked
+struct ZstdDictionaryRegistry {
+  std::mutex mutex;
+  std::unordered_map<uint32_t, std::shared_ptr<ZstdDictionary>> dictionaries;
+  uint32_t add(const char * const dict, const uint64_t dict_size) {
+    uint32_t id = ZSTD_getDictID_fromDict(dict, dict_size);
+    if(id == 0) throw std::runtime_error("not a zstd dictionary, see zstd_train_dictionary");
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = dictionaries.find(id);
+    // already registered: keep the digested dictionaries
+    if(it != dictionaries.end() && it->second->data.size() == dict_size && std::memcmp(it->second->data.data(), dict, dict_size) == 0) return id;
+    dictionaries[id] = std::make_shared<ZstdDictionary>(dict, dict_size);
+    return id;
+  }
+  // nullptr if the dictionary is not registered
+  std::shared_ptr<ZstdDictionary> find(const uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = dictionaries.find(id);
+    return it == dictionaries.end() ? nullptr : it->second;
+  }
+  std::shared_ptr<ZstdDictionary> get(const uint32_t id) {
+    std::shared_ptr<ZstdDictionary> d = find(id);
+    if(d == nullptr) throw std::runtime_error("zstd dictionary " + std::to_string(id) + " is not registered, see register_zstd_dictionary");
+    return d;
+  }
+};
+
+inline ZstdDictionaryRegistry & zstd_dictionaries() {
+  static ZstdDictionaryRegistry registry;
+  return registry;
+}
+
+// ZSTD_decompress, with the registered dictionary if the frame names one (qdump)
+inline size_t ZSTD_decompress_fun( void* dst, size_t dstCapacity,
+                                   const void* src, size_t compressedSize) {
+  uint32_t id = ZSTD_getDictID_fromFrame(src, compressedSize);
+  if(id == 0) return ZSTD_decompress(dst, dstCapacity, src, compressedSize);
+  std::shared_ptr<ZstdDictionary> dictionary = zstd_dictionaries().find(id);
+  if(dictionary == nullptr) return SIZE_MAX; // an error code for ZSTD_isError
+  ZSTD_DCtx* dctx = ZSTD_createDCtx();
+  size_t ret = ZSTD_decompress_usingDDict(dctx, dst, dstCapacity, src, compressedSize, dictionary->ddict);
+  ZSTD_freeDCtx(dctx);
+  return ret;
+}
+
+// the zstd envs own their context so that it is allocated once and reused for every block
+// one env per thread, a context must not be used concurrently
 struct zstd_compress_env {
-  // ZSTD_CCtx* zcs;
-  // zstd_compress_env() : zcs(ZSTD_createCCtx()) {}
-  // ~zstd_compress_env() {
-  //   ZSTD_freeCCtx(zcs);
-  // }
+  ZSTD_CCtx* zcs;
+  std::shared_ptr<ZstdDictionary> dictionary;
+  ZSTD_CDict* cdict = nullptr; // owned by dictionary, digested for the compression level of the file
+  zstd_compress_env() : zcs(ZSTD_createCCtx()) {
+    if(zcs == nullptr) throw std::runtime_error("zstd context allocation error");
+  }
+  ~zstd_compress_env() {
+    ZSTD_freeCCtx(zcs);
+  }
+  zstd_compress_env(const zstd_compress_env &) = delete;
+  zstd_compress_env & operator=(const zstd_compress_env &) = delete;
+  // called from the main thread before any block is compressed
+  void useDictionary(const QsMetadata & qm) {
+    if(qm.dict_id == 0) return;
+    dictionary = zstd_dictionaries().get(qm.dict_id);
+    cdict = dictionary->getCDict(qm.compress_level);
+  }
   uint64_t compress( void * dst, size_t dstCapacity,
                    const void * src, size_t srcSize,
                    int compressionLevel) {
-    // return ZSTD_compressCCtx(zcs, dst, dstCapacity, src, srcSize, compressionLevel);
-    uint64_t return_value = ZSTD_compress(dst, dstCapacity, src, srcSize, compressionLevel);
+    uint64_t return_value = cdict == nullptr ? ZSTD_compressCCtx(zcs, dst, dstCapacity, src, srcSize, compressionLevel) :
+                                               ZSTD_compress_usingCDict(zcs, dst, dstCapacity, src, srcSize, cdict);
     if(ZSTD_isError(return_value)) throw std::runtime_error("zstd compression error");
     return return_value;
   }
@@ -994,6 +1457,7 @@ struct lz4_compress_env {
   //   zcs = std::vector<char>(LZ4_sizeofState());
   //   state = zcs.data();
   // }
+  void useDictionary(const QsMetadata &) {} // dictionaries are only used with zstd
   uint64_t compress( char * dst, int dstCapacity,
                    const char * src, int srcSize,
                    int compressionLevel) {
@@ -1016,6 +1480,7 @@ struct lz4hc_compress_env {
   //   zcs = std::vector<char>(LZ4_sizeofStateHC());
   //   state = zcs.data();
   // }
+  void useDictionary(const QsMetadata &) {} // dictionaries are only used with zstd
   uint64_t compress( char * dst, int dstCapacity,
                    const char * src, int srcSize,
                    int compressionLevel) {
@@ -1032,25 +1497,72 @@ struct lz4hc_compress_env {
   }
 };
 
+// blocks that do not compress are written as is, the high bit of the block size marks them (see raw_block_flag)
+// the compressed size of a block is at most compressBound(MAX_BLOCKSIZE) < 2^31, so the bit is otherwise unused
+static constexpr uint32_t RAW_BLOCK_BIT = 0x80000000UL;
+static constexpr uint64_t ENTROPY_SAMPLE_SIZE = 4096ULL; // bytes sampled per block, smaller blocks are always compressed
+static constexpr double RAW_BLOCK_ENTROPY = 7.9; // bits per byte; blocks sampled above this are not compressed
+static constexpr uint64_t RAW_BLOCK_MIN_SAVING = 64ULL; // compressed blocks must be at least 1/64 smaller, or they are stored as is
+
+// order 0 entropy of evenly spaced bytes of the block
+// the stride is odd so that every byte position of a multi-byte type is sampled
+inline double sample_entropy(const char * const src, const uint64_t srcSize) {
+  std::array<uint32_t, 256> counts = {};
+  uint64_t stride = (srcSize / ENTROPY_SAMPLE_SIZE) | 1ULL;
+  uint64_t n = 0;
+  for(uint64_t i=0; i<srcSize; i += stride, n++) counts[static_cast<uint8_t>(src[i])]++;
+  double entropy = 0;
+  for(uint32_t c : counts) {
+    if(c == 0) continue;
+    double p = static_cast<double>(c) / n;
+    entropy -= p * std::log2(p);
+  }
+  return entropy;
+}
+
+// returns the block size to write before the block
+// with RAW_BLOCK_BIT set the block is stored as is and the payload is src instead of dst
+template <class compress_env>
+uint64_t compress_block(compress_env & cenv, char * const dst, const uint64_t dstCapacity, const char * const src, const uint64_t srcSize,
+                        const int compress_level, const bool raw_blocks) {
+  if(raw_blocks && srcSize >= ENTROPY_SAMPLE_SIZE && sample_entropy(src, srcSize) > RAW_BLOCK_ENTROPY) return srcSize | RAW_BLOCK_BIT;
+  uint64_t zsize = cenv.compress(dst, dstCapacity, src, srcSize, compress_level);
+  if(raw_blocks && zsize > srcSize - srcSize / RAW_BLOCK_MIN_SAVING) return srcSize | RAW_BLOCK_BIT;
+  return zsize;
+}
+
+// number of bytes following the block size
+inline uint64_t block_payload_size(const uint64_t zsize) {
+  return zsize & ~static_cast<uint64_t>(RAW_BLOCK_BIT);
+}
 
 // Explicit decompression context (zstd v. 1.4.0)
 struct zstd_decompress_env {
-  // ZSTD_DCtx* zcs;
-  // zstd_decompress_env() : zcs(ZSTD_createDCtx()) {}
-  // ~zstd_decompress_env() {
-  //   ZSTD_freeDCtx(zcs);
-  // }
-  uint64_t bound;
-  zstd_decompress_env() : bound(ZSTD_compressBound(BLOCKSIZE)) {}
+  ZSTD_DCtx* zcs;
+  uint32_t dict_id = 0; // dictionary of the last block
+  std::shared_ptr<ZstdDictionary> dictionary;
+  zstd_decompress_env() : zcs(ZSTD_createDCtx()) {
+    if(zcs == nullptr) throw std::runtime_error("zstd context allocation error");
+  }
+  ~zstd_decompress_env() {
+    ZSTD_freeDCtx(zcs);
+  }
+  zstd_decompress_env(const zstd_decompress_env &) = delete;
+  zstd_decompress_env & operator=(const zstd_decompress_env &) = delete;
   uint64_t decompress( void* dst, size_t dstCapacity,
                      const void* src, size_t compressedSize) {
-    // return ZSTD_decompress(dst, dstCapacity, src, compressedSize);
-    // return ZSTD_decompressDCtx(zcs, dst, dstCapacity, src, compressedSize);
-    if(compressedSize > bound) throw std::runtime_error("Malformed compress block: compressed size > compress bound");
+    // dstCapacity is the block size of the file
+    if(compressedSize > ZSTD_compressBound(dstCapacity)) throw std::runtime_error("Malformed compress block: compressed size > compress bound");
     // std::cout << "decompressing " << dst << " " << dstCapacity << " " << src << " " << compressedSize << "\n";
-    uint64_t return_value = ZSTD_decompress(dst, dstCapacity, src, compressedSize);
+    uint32_t id = ZSTD_getDictID_fromFrame(src, compressedSize);
+    if(id != dict_id) {
+      dictionary = id == 0 ? nullptr : zstd_dictionaries().get(id);
+      dict_id = id;
+    }
+    uint64_t return_value = dictionary == nullptr ? ZSTD_decompressDCtx(zcs, dst, dstCapacity, src, compressedSize) :
+                                                    ZSTD_decompress_usingDDict(zcs, dst, dstCapacity, src, compressedSize, dictionary->ddict);
     if(ZSTD_isError(return_value)) throw std::runtime_error("zstd decompression error");
-    if(return_value > BLOCKSIZE) throw std::runtime_error("Malformed compress block: decompressed size > max blocksize " + std::to_string(return_value));
+    if(return_value > dstCapacity) throw std::runtime_error("Malformed compress block: decompressed size > max blocksize " + std::to_string(return_value));
     return return_value;
   }
   uint64_t compressBound(uint64_t srcSize) {
@@ -1059,15 +1571,14 @@ struct zstd_decompress_env {
 };
 
 struct lz4_decompress_env {
-  uint64_t bound;
-  lz4_decompress_env() : bound(LZ4_compressBound(BLOCKSIZE)) {}
   uint64_t decompress( char * dst, int dstCapacity,
                      const char* src, int compressedSize) {
     // std::cout << "decomp " << compressedSize << std::endl;
-    if(static_cast<uint64_t>(compressedSize) > bound) throw std::runtime_error("Malformed compress block: compressed size > compress bound");
+    // dstCapacity is the block size of the file
+    if(compressedSize > LZ4_compressBound(dstCapacity)) throw std::runtime_error("Malformed compress block: compressed size > compress bound");
     int return_value = LZ4_decompress_safe(src, dst, compressedSize, dstCapacity);
     if(return_value < 0) throw std::runtime_error("lz4 decompression error");
-    if(static_cast<uint64_t>(return_value) > BLOCKSIZE) throw std::runtime_error("Malformed compress block: decompressed size > max blocksize" + std::to_string(return_value));
+    if(return_value > dstCapacity) throw std::runtime_error("Malformed compress block: decompressed size > max blocksize" + std::to_string(return_value));
     return return_value;
     // return LZ4_decompress_safe(reinterpret_cast<char*>(const_cast<void*>(src)),
     //                                        reinterpret_cast<char*>(const_cast<void*>(dst)),
@@ -1079,6 +1590,159 @@ struct lz4_decompress_env {
 };
 
 
+////////////////////////////////////////////////////////////////
+// worker thread pool shared by multi-threaded qsave and qread
+////////////////////////////////////////////////////////////////
+
+// handoff between the main thread and the worker threads of a context
+// waiters spin briefly, since the other side usually answers within a few microseconds, then block on the condition variable
+// so that waiting threads do not take CPU time from other processes on oversubscribed machines
+// the state tested by the predicate is atomic; notify() must be called after every change to it
+static constexpr int THREAD_SIGNAL_SPINS = 64;
+struct ThreadSignal {
+  std::mutex mutex;
+  std::condition_variable cv;
+  template <class Predicate>
+  void wait(Predicate pred) {
+    for(int i=0; i < THREAD_SIGNAL_SPINS; i++) {
+      if(pred()) return;
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, pred);
+  }
+  void notify() {
+    // taking the mutex orders the state change before a waiter that is between checking the predicate and blocking
+    { std::lock_guard<std::mutex> lock(mutex); }
+    cv.notify_all();
+  }
+};
+
+// tasks submitted together by one Compress_Thread_Context or Data_Thread_Context
+struct TaskGroup {
+  std::mutex mutex;
+  std::condition_variable cv;
+  unsigned int remaining = 0;
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this]{ return remaining == 0; });
+  }
+  void task_done() {
+    std::lock_guard<std::mutex> lock(mutex);
+    remaining--;
+    if(remaining == 0) cv.notify_all();
+  }
+};
+
+// threads are created on first use and then kept for the life of the process, up to limit threads
+// the worker tasks of a context wait on each other, so every submitted task must get its own thread:
+// a context submits at most concurrency(n) tasks. Only the R thread submits, and a context waits for its tasks
+// before it is destroyed, so the tasks of one context never wait for a thread held by another
+class ThreadPool {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::pair<std::function<void()>, TaskGroup*>> queue;
+  std::vector<std::thread> workers;
+  unsigned int busy = 0; // tasks queued or running
+  unsigned int limit = default_limit(); // set by set_thread_pool_size
+  bool stop = false;
+#ifndef _WIN32
+  pid_t owner = getpid();
+#endif
+
+  void worker_loop() {
+    while(true) {
+      std::pair<std::function<void()>, TaskGroup*> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this]{ return stop || !queue.empty(); });
+        if(queue.empty()) return;
+        task = std::move(queue.front());
+        queue.pop_front();
+      }
+      // an exception escaping a task terminates the process, tasks catch their errors and pass them to the main thread
+      task.first();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy--;
+      }
+      task.second->task_done();
+    }
+  }
+  void stop_workers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    for(auto & w : workers) w.join();
+    std::lock_guard<std::mutex> lock(mutex);
+    workers.clear();
+    stop = false;
+  }
+  static unsigned int default_limit() {
+    return std::max(1U, std::thread::hardware_concurrency());
+  }
+  // the threads of a forked parent do not exist in the child, forget them instead of joining
+  void check_fork() {
+#ifndef _WIN32
+    if(owner == getpid()) return;
+    owner = getpid();
+    new std::vector<std::thread>(std::move(workers)); // intentionally leaked
+    workers.clear();
+    queue.clear();
+    busy = 0;
+#endif
+  }
+public:
+  ~ThreadPool() {
+    stop_workers();
+  }
+  unsigned int size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    check_fork();
+    return workers.size();
+  }
+  // the number of tasks of a context that can run at once
+  unsigned int concurrency(const unsigned int ntasks) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::min(ntasks, limit);
+  }
+  // starts nthreads threads and makes nthreads the limit; 0 stops the threads and restores the default limit
+  // only called from the R thread while no tasks are running
+  void resize(const unsigned int nthreads) {
+    std::unique_lock<std::mutex> lock(mutex);
+    check_fork();
+    limit = nthreads > 0 ? nthreads : default_limit();
+    if(nthreads < workers.size()) {
+      lock.unlock();
+      stop_workers();
+      lock.lock();
+    }
+    while(workers.size() < nthreads) workers.push_back(std::thread(&ThreadPool::worker_loop, this));
+  }
+  void submit(TaskGroup & group, std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> group_lock(group.mutex);
+      group.remaining++;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      check_fork();
+      busy++;
+      while(workers.size() < std::min(busy, limit)) workers.push_back(std::thread(&ThreadPool::worker_loop, this));
+      queue.push_back(std::make_pair(std::move(task), &group));
+    }
+    cv.notify_one();
+  }
+};
+
+inline ThreadPool & thread_pool() {
+  static ThreadPool pool;
+  return pool;
+}
+
+
 ////////////////////////////////////////////////////////////////
 // qdump/debug helper functions
 ////////////////////////////////////////////////////////////////
@@ -1112,6 +1776,16 @@ void dumpMetadata(List & output, const QsMetadata & qm) {
   output["endian"] = static_cast<int>(qm.endian);
   output["check_hash"] = qm.check_hash;
   output["format_version"] = qm.format_version;
+  output["block_index"] = qm.block_index;
+  output["element_index"] = qm.element_index;
+  output["block_sentinel"] = qm.block_sentinel;
+  output["alignment"] = static_cast<double>(qm.alignment);
+  output["block_size"] = static_cast<double>(qm.block_size);
+  output["raw_blocks"] = qm.raw_blocks;
+  output["dictionary"] = qm.dictionary;
+  output["block_hash"] = qm.block_hash;
+  output["string_dedup"] = qm.string_dedup;
+  output["window_log"] = qm.window_log;
 }
 
 // simple decompress stream context
@@ -1121,7 +1795,7 @@ struct zstd_decompress_stream_simple {
   ZSTD_outBuffer zout;
   ZSTD_DStream* zds;
   std::vector<char> outblock;
-  zstd_decompress_stream_simple(uint64_t outsize, char* inp, uint64_t insize) {
+  zstd_decompress_stream_simple(uint64_t outsize, char* inp, uint64_t insize, int window_log = 0) {
     if(outsize == 0) {
       outblock = std::vector<char>(BLOCKSIZE);
       zout.size = BLOCKSIZE;
@@ -1135,6 +1809,7 @@ struct zstd_decompress_stream_simple {
     zin.src = inp;
     zin.size = insize;
     zds = ZSTD_createDStream();
+    if(window_log > 0) ZSTD_DCtx_setParameter(zds, ZSTD_d_windowLogMax, window_log);
   }
 
   bool decompress() {
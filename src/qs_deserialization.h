@@ -34,13 +34,17 @@ struct Data_Context {
   decompress_env denv; // default constructor
   xxhash_env xenv; // default constructor
   std::unordered_map<uint32_t, SEXP> object_ref_hash;
+  StringTable string_table; // see string_dedup_flag
+  ColumnarStringData columnar; // scratch space of readCharacterColumnar, reused for every vector read
 
-  std::vector<char> zblock = std::vector<char>(denv.compressBound(BLOCKSIZE));
-  std::vector<char> block = std::vector<char>(BLOCKSIZE);
+  std::vector<char> zblock = std::vector<char>(denv.compressBound(qm.block_size));
+  std::vector<char> block = std::vector<char>(qm.block_size);
   std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
   uint64_t data_offset = 0;
   uint64_t blocks_read = 0;
   uint64_t block_size = 0;
+  bool block_buffered = false; // block holds the decompressed data of block number blocks_read - 1
+  std::shared_ptr<const LazyFile> lazy_file; // set when large vectors are read lazily, requires the block index
 
   Data_Context(stream_reader & mf, QsMetadata qm, bool use_alt_rep) :
     qm(qm), myFile(mf), use_alt_rep_bool(use_alt_rep) {}
@@ -60,27 +64,87 @@ struct Data_Context {
     char* header = block.data();
     readFlags_common(packed_flags, data_offset, header);
   }
-  void decompress_direct(char* bpointer) {
-    blocks_read++;
-    std::array<char, 4> zsize_ar;
-    read_allow(myFile, zsize_ar.data(), 4);
-    uint64_t zsize = *reinterpret_cast<uint32_t*>(zsize_ar.data());
-    read_allow(myFile, zblock.data(), zsize);
-    block_size = denv.decompress(bpointer, BLOCKSIZE, zblock.data(), zsize);
-    if(qm.check_hash) xenv.update(bpointer, BLOCKSIZE);
-  }
-  void decompress_block() {
+  // reads the next block into bpointer, blocks stored as is are read without a copy
+  uint64_t read_block(char* bpointer) {
     blocks_read++;
     std::array<char, 4> zsize_ar;
     // uint64_t bytes_read = read_allow(myFile, zsize_ar.data(), 4);
     // if(bytes_read == 0) return;
     read_allow(myFile, zsize_ar.data(), 4);
     uint64_t zsize = *reinterpret_cast<uint32_t*>(zsize_ar.data());
-    read_allow(myFile, zblock.data(), zsize);
-    block_size = denv.decompress(block.data(), BLOCKSIZE, zblock.data(), zsize);
+    uint64_t recorded_hash = qm.block_hash ? readSize8(myFile) : 0;
+    uint64_t bsize;
+    if(qm.raw_blocks && (zsize & RAW_BLOCK_BIT)) {
+      bsize = block_payload_size(zsize);
+      if(bsize > qm.block_size) throw std::runtime_error("Malformed compress block: stored size > max blocksize");
+      read_allow(myFile, bpointer, bsize);
+    } else {
+      if(zsize > zblock.size()) throw std::runtime_error("Malformed compress block: compressed size > compress bound");
+      read_allow(myFile, zblock.data(), zsize);
+      bsize = denv.decompress(bpointer, qm.block_size, zblock.data(), zsize);
+    }
+    if(qm.block_hash) checkBlockHash(bpointer, bsize, recorded_hash, blocks_read);
+    return bsize;
+  }
+  void decompress_direct(char* bpointer) {
+    block_size = read_block(bpointer);
+    block_buffered = false;
+    if(qm.check_hash) xenv.update(bpointer, qm.block_size);
+  }
+  void decompress_block() {
+    block_size = read_block(block.data());
     data_offset = 0;
+    block_buffered = true;
     if(qm.check_hash) xenv.update(block.data(), block_size);
   }
+  // called after the object is read, skips the zero length block that ends the data of a stream (see block_sentinel_flag)
+  void finish() {
+    if(qm.block_sentinel && readSize4(myFile) != 0) throw std::runtime_error("QS format error: end of block data not found");
+  }
+  // random access using the block index footer -- requires a seekable reader
+  // the running hash is not meaningful after seeking
+  void seekBlock(const BlockIndex & bi, const uint64_t block_number) {
+    if(block_number >= bi.size()) throw std::runtime_error("block number is beyond the end of the block index");
+    myFile.seekg(bi.file_offsets[block_number]);
+    blocks_read = block_number;
+    block_size = 0;
+    data_offset = 0;
+    block_buffered = false;
+  }
+  void seekOffset(const BlockIndex & bi, const uint64_t offset) {
+    uint64_t block_number = bi.findBlock(offset);
+    if(!block_buffered || blocks_read != block_number + 1) { // otherwise the block is already decompressed
+      seekBlock(bi, block_number);
+      decompress_block();
+    }
+    data_offset = offset - bi.decompressed_offsets[block_number];
+  }
+  // position of the next byte to be read within the uncompressed data
+  uint64_t decompressed_offset(const BlockIndex & bi) const {
+    return blocks_read == 0 ? 0 : bi.decompressed_offsets[blocks_read - 1] + data_offset;
+  }
+  // same end state as getBlockData, but only the block containing the last byte is decompressed
+  void skipBlockData(const BlockIndex & bi, const uint64_t data_size) {
+    if(data_size <= block_size - data_offset) {
+      data_offset += data_size;
+      return;
+    }
+    uint64_t end_offset = decompressed_offset(bi) + data_size;
+    uint64_t block_number = bi.findBlock(end_offset - 1);
+    seekBlock(bi, block_number);
+    decompress_block();
+    data_offset = end_offset - bi.decompressed_offsets[block_number];
+  }
+  // payload alignment is only used by the uncompressed format
+  void alignData(const uint64_t data_size) {}
+  // vectors spanning at least one full block are returned as ALTREP objects that are read from the file on first access
+  SEXP lazyVector(const SEXPTYPE type, const uint64_t length, const uint64_t bytesoftype, const bool shuffle) {
+    uint64_t data_size = length * bytesoftype;
+    if(!lazy_file || data_size < qm.block_size) return R_NilValue;
+    SEXP obj = make_lazy_vector(lazy_file, decompressed_offset(lazy_file->bi), type, length, shuffle);
+    skipBlockData(lazy_file->bi, data_size);
+    return obj;
+  }
   void getBlockData(char* outp, uint64_t data_size) {
     if(data_size <= block_size - data_offset) {
       memcpy(outp, block.data()+data_offset, data_size);
@@ -89,10 +153,10 @@ struct Data_Context {
       uint64_t bytes_accounted = block_size - data_offset;
       memcpy(outp, block.data()+data_offset, bytes_accounted);
       while(bytes_accounted < data_size) {
-        if(data_size - bytes_accounted >= BLOCKSIZE) {
+        if(data_size - bytes_accounted >= qm.block_size) {
           decompress_direct(outp+bytes_accounted);
-          bytes_accounted += BLOCKSIZE;
-          data_offset = BLOCKSIZE;
+          bytes_accounted += qm.block_size;
+          data_offset = qm.block_size;
         } else {
           decompress_block();
           std::memcpy(outp + bytes_accounted, block.data(), data_size - bytes_accounted);
@@ -125,3 +189,236 @@ struct Data_Context {
     }
   }
 };
+
+// reads the blocks of a file in order for qinspect, only the current block is kept in memory
+// statistics are recorded for every block, and the object headers starting in each block are counted (see inspectObject)
+// the data of the blocks in dump_blocks is kept to be returned
+template <class decompress_env>
+struct Inspect_Context {
+  QsMetadata qm;
+  std::ifstream & myFile;
+  decompress_env denv; // default constructor
+  xxhash_env xenv; // default constructor
+  std::vector<char> zblock = std::vector<char>(denv.compressBound(qm.block_size));
+  std::vector<char> block = std::vector<char>(qm.block_size);
+  uint64_t data_offset = 0;
+  uint64_t block_size = 0;
+  bool end_of_blocks = false;
+  std::unordered_set<uint64_t> dump_blocks; // block numbers counting from 0
+
+  // statistics of every block read
+  std::vector<double> zblock_sizes;
+  std::vector<double> block_sizes;
+  std::vector<int> stored_raw;
+  std::vector<uint64_t> computed_block_hashes;
+  std::vector<uint64_t> recorded_block_hashes;
+  std::vector<uint32_t> header_types; // bit i is set if a header of qstype i starts in the block
+  std::vector<uint64_t> header_counts = std::vector<uint64_t>(QSTYPE_COUNT);
+  // data of the dumped blocks, in the order read
+  std::vector<uint64_t> dumped_blocks;
+  std::vector<std::vector<char>> dumped_zdata;
+  std::vector<std::vector<char>> dumped_data;
+
+  Inspect_Context(std::ifstream & mf, QsMetadata qm) : qm(qm), myFile(mf) {}
+
+  uint64_t blocks_read() const {
+    return block_sizes.size();
+  }
+  // reads the next block, returns false at the end of the blocks
+  bool read_block() {
+    if(end_of_blocks) return false;
+    if(!qm.block_sentinel && qm.clength != 0 && blocks_read() == qm.clength) {
+      end_of_blocks = true;
+      return false;
+    }
+    uint64_t zsize = readSize4(myFile);
+    if(qm.block_sentinel && zsize == 0) {
+      end_of_blocks = true;
+      return false;
+    }
+    uint64_t recorded_hash = qm.block_hash ? readSize8(myFile) : 0;
+    bool raw = qm.raw_blocks && (zsize & RAW_BLOCK_BIT);
+    uint64_t payload_size = block_payload_size(zsize);
+    if(payload_size > (raw ? qm.block_size : zblock.size())) throw std::runtime_error("Malformed compress block: compressed size > compress bound");
+    read_check(myFile, raw ? block.data() : zblock.data(), payload_size);
+    block_size = raw ? payload_size : denv.decompress(block.data(), qm.block_size, zblock.data(), payload_size);
+    data_offset = 0;
+    if(qm.check_hash) xenv.update(block.data(), block_size);
+    zblock_sizes.push_back(static_cast<double>(payload_size));
+    block_sizes.push_back(static_cast<double>(block_size));
+    stored_raw.push_back(raw);
+    computed_block_hashes.push_back(blockHash(block.data(), block_size));
+    recorded_block_hashes.push_back(recorded_hash);
+    header_types.push_back(0);
+    if(dump_blocks.count(blocks_read() - 1) > 0) {
+      dumped_blocks.push_back(blocks_read() - 1);
+      dumped_zdata.push_back(raw ? std::vector<char>(block.begin(), block.begin() + payload_size) :
+                                   std::vector<char>(zblock.begin(), zblock.begin() + payload_size));
+      dumped_data.push_back(std::vector<char>(block.begin(), block.begin() + block_size));
+    }
+    return true;
+  }
+  void next_block() {
+    if(!read_block()) throw std::runtime_error("unexpected end of data");
+  }
+  // reads the blocks following the object, if the end of the blocks is known
+  void finish() {
+    if(qm.block_sentinel || qm.clength != 0) {
+      while(read_block()) {}
+    }
+  }
+  void readHeader(qstype & object_type, uint64_t & r_array_len) {
+    if(data_offset >= block_size) next_block();
+    readHeader_common(object_type, r_array_len, data_offset, block.data());
+    header_counts[static_cast<int>(object_type)]++;
+    header_types.back() |= 1u << static_cast<int>(object_type);
+  }
+  void readStringHeader(uint32_t & r_string_len, cetype_t & ce_enc) {
+    if(data_offset >= block_size) next_block();
+    readStringHeader_common(r_string_len, ce_enc, data_offset, block.data());
+  }
+  void readFlags(int & packed_flags) {
+    if(data_offset >= block_size) next_block();
+    readFlags_common(packed_flags, data_offset, block.data());
+  }
+  // payload alignment is only used by the uncompressed format
+  void alignData(const uint64_t data_size) {}
+  void skipData(uint64_t data_size) {
+    while(data_size > block_size - data_offset) {
+      data_size -= block_size - data_offset;
+      next_block();
+    }
+    data_offset += data_size;
+  }
+  // for the few bytes of data inspectObject needs, e.g. the code width of a CHARACTER_DICT vector
+  void getBlockData(char* outp, uint64_t data_size) {
+    while(data_size > block_size - data_offset) {
+      uint64_t available = block_size - data_offset;
+      std::memcpy(outp, block.data() + data_offset, available);
+      outp += available;
+      data_size -= available;
+      next_block();
+    }
+    std::memcpy(outp, block.data() + data_offset, data_size);
+    data_offset += data_size;
+  }
+};
+
+// reads uncompressed files directly from a memory map of the file (qread_mmap)
+// large unshuffled vectors that are suitably aligned within the map are returned as ALTREP views instead of copies
+struct Data_Context_Mmap {
+  QsMetadata qm;
+  std::shared_ptr<const MmapFile> mmap_file;
+  char * data; // start of the uncompressed data, directly after the header
+  uint64_t total_size; // length of the uncompressed data
+  bool use_alt_rep_bool;
+  bool views_created = false;
+  std::unordered_map<uint32_t, SEXP> object_ref_hash;
+  StringTable string_table; // see string_dedup_flag
+  ColumnarStringData columnar; // scratch space of readCharacterColumnar, reused for every vector read
+  std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
+  std::array<char, BLOCKRESERVE> tail; // zero padded copy of headers within BLOCKRESERVE bytes of the end of the data
+  uint64_t data_offset = 0;
+
+  Data_Context_Mmap(const std::shared_ptr<const MmapFile> & mf, QsMetadata qm, bool use_alt_rep) :
+    qm(qm), mmap_file(mf), data(mf->map + QS_HEADER_LENGTH), total_size(qm.clength), use_alt_rep_bool(use_alt_rep) {
+    if(QS_HEADER_LENGTH + total_size > mf->length) throw std::runtime_error("file is truncated");
+  }
+
+  const char * headerPtr() {
+    if(data_offset + BLOCKRESERVE <= total_size) return data + data_offset;
+    if(data_offset >= total_size) throw std::runtime_error("unexpected end of data");
+    tail.fill(0);
+    std::memcpy(tail.data(), data + data_offset, total_size - data_offset);
+    return tail.data();
+  }
+  void readHeader(qstype & object_type, uint64_t & r_array_len) {
+    uint64_t header_offset = 0;
+    readHeader_common(object_type, r_array_len, header_offset, headerPtr());
+    data_offset += header_offset;
+  }
+  void readStringHeader(uint32_t & r_string_len, cetype_t & ce_enc) {
+    uint64_t header_offset = 0;
+    readStringHeader_common(r_string_len, ce_enc, header_offset, headerPtr());
+    data_offset += header_offset;
+  }
+  void readFlags(int & packed_flags) {
+    uint64_t header_offset = 0;
+    readFlags_common(packed_flags, header_offset, headerPtr());
+    data_offset += header_offset;
+  }
+  void alignData(const uint64_t data_size) {
+    data_offset += alignmentPadding(qm, QS_HEADER_LENGTH + data_offset, data_size);
+  }
+  SEXP lazyVector(const SEXPTYPE type, const uint64_t length, const uint64_t bytesoftype, const bool shuffle) {
+    uint64_t data_size = length * bytesoftype;
+    if(shuffle || data_size < MIN_MMAP_VIEW_BYTES || data_offset + data_size > total_size) return R_NilValue;
+    char * ptr = data + data_offset;
+    if(reinterpret_cast<uintptr_t>(ptr) % bytesoftype != 0) return R_NilValue;
+    SEXP obj = make_mmap_view(mmap_file, ptr, type, length);
+    if(obj == R_NilValue) return obj;
+    data_offset += data_size;
+    views_created = true;
+    return obj;
+  }
+  void getBlockData(char* outp, uint64_t data_size) {
+    if(data_offset + data_size > total_size) throw std::runtime_error("unexpected end of data");
+    std::memcpy(outp, data + data_offset, data_size);
+    data_offset += data_size;
+  }
+  char * tempBlock(uint64_t data_size) {
+    if(data_size > shuffleblock.size()) shuffleblock.resize(data_size);
+    return reinterpret_cast<char*>(shuffleblock.data());
+  }
+  char * tempBlock() {
+    return reinterpret_cast<char*>(shuffleblock.data());
+  }
+  std::string getString(uint64_t data_size) {
+    std::string temp_string;
+    temp_string.resize(data_size);
+    getBlockData(&temp_string[0], data_size);
+    return temp_string;
+  }
+  void getShuffleBlockData(char* outp, uint64_t data_size, uint64_t bytesoftype) {
+    if(data_size >= MIN_SHUFFLE_ELEMENTS) {
+      if(data_offset + data_size > total_size) throw std::runtime_error("unexpected end of data");
+      blosc_unshuffle(reinterpret_cast<uint8_t*>(data + data_offset), reinterpret_cast<uint8_t*>(outp), data_size, bytesoftype);
+      data_offset += data_size;
+    } else if(data_size > 0) {
+      getBlockData(outp, data_size);
+    }
+  }
+};
+
+// reads selected elements of a top level list using the element and block indices
+// only the blocks containing the list header, the selected elements and the list attributes are decompressed
+template <class decompress_env>
+SEXP readElements(std::ifstream & myFile, const QsMetadata & qm, const BlockIndex & bi, const ElementIndex & ei,
+                  SEXP const elements, const bool use_alt_rep, const std::shared_ptr<const LazyFile> & lazy_file) {
+  Protect_Tracker pt = Protect_Tracker();
+  Data_Context<std::ifstream, decompress_env> dc(myFile, qm, use_alt_rep);
+  dc.lazy_file = lazy_file;
+  dc.seekOffset(bi, 0);
+  qstype obj_type;
+  uint64_t r_array_len;
+  uint64_t number_of_attributes = 0;
+  dc.readHeader(obj_type, r_array_len);
+  if(obj_type == qstype::ATTRIBUTE) {
+    number_of_attributes = r_array_len;
+    dc.readHeader(obj_type, r_array_len);
+  }
+  if(obj_type != qstype::LIST || r_array_len != ei.elements()) throw std::runtime_error("element index is corrupted");
+  SEXP attributes = R_NilValue;
+  if(number_of_attributes > 0) {
+    dc.seekOffset(bi, ei.offsets[r_array_len]);
+    attributes = PROTECT(processAttributeList(&dc, number_of_attributes)); pt++;
+  }
+  std::vector<uint64_t> selected = selectElements(elements, r_array_len, attributes);
+  SEXP ret = PROTECT(Rf_allocVector(VECSXP, selected.size())); pt++;
+  for(uint64_t i=0; i<selected.size(); i++) {
+    dc.seekOffset(bi, ei.offsets[selected[i]]);
+    SET_VECTOR_ELT(ret, i, processBlock(&dc));
+  }
+  setSubsetAttributes(ret, attributes, selected);
+  return ret;
+}
@@ -46,6 +46,7 @@ struct ZSTD_streamRead {
     qm(qm), myFile(mf) {
     zds = ZSTD_createDStream();
     ZSTD_initDStream(zds);
+    if(qm.window_log > 0) ZSTD_DCtx_setParameter(zds, ZSTD_d_windowLogMax, qm.window_log);
     zout.size = maxblocksize;
     zout.pos = 0;
     zout.dst = outblock.data();
@@ -197,6 +198,127 @@ struct ZSTD_streamRead {
   }
 };
 
+// zstd_stream is a single frame and can only be decompressed sequentially, but decompression can overlap with
+// building the R objects: a second thread decompresses ahead into a ring of chunks (using ZSTD_streamRead)
+// while the main thread consumes them. Same interface as ZSTD_streamRead for Data_Context_Stream
+// the decompression thread blocks for the whole read, so it is started for each read instead of taking a thread of the pool
+static constexpr uint64_t STREAM_READ_CHUNKS = 4;
+template <class stream_reader>
+struct ZSTD_streamRead_MT {
+  ZSTD_streamRead<stream_reader> sr; // only used by the decompression task until finish()
+  xxhash_env & xenv; // sr.xenv
+  std::array<char, 4> & hash_reserve; // sr.hash_reserve
+  uint64_t decompressed_bytes_read = 0; // bytes consumed by the main thread
+  std::vector<char> outblock = std::vector<char>(sr.maxblocksize);
+  uint64_t blocksize = 0; // shared with Data_Context_Stream by reference -- block_size
+  uint64_t blockoffset = 0; // shared with Data_Context_Stream by reference -- data_offset
+
+  // a chunk that is not full is the last one
+  std::vector< std::vector<char> > chunks = std::vector< std::vector<char> >(STREAM_READ_CHUNKS, std::vector<char>(sr.maxblocksize));
+  std::vector<uint64_t> chunk_sizes = std::vector<uint64_t>(STREAM_READ_CHUNKS, 0);
+  std::vector< std::atomic<bool> > chunk_ready = std::vector< std::atomic<bool> >(STREAM_READ_CHUNKS);
+  uint64_t chunks_consumed = 0;
+  uint64_t chunk_offset = 0;
+  std::atomic<bool> aborted;
+  std::atomic<bool> failed;
+  std::string error_message; // written before failed is set
+  ThreadSignal signal; // notified on every change to chunk_ready, aborted and failed
+  std::thread decompressor;
+
+  ZSTD_streamRead_MT(stream_reader & mf, QsMetadata qm) :
+    sr(mf, qm), xenv(sr.xenv), hash_reserve(sr.hash_reserve), aborted(false), failed(false) {
+    for(uint64_t i=0; i<STREAM_READ_CHUNKS; i++) chunk_ready[i] = false;
+    decompressor = std::thread(&ZSTD_streamRead_MT::decompress_thread, this);
+  }
+  ~ZSTD_streamRead_MT() {
+    aborted = true;
+    signal.notify();
+    if(decompressor.joinable()) decompressor.join();
+  }
+
+  void decompress_thread() {
+    try {
+      for(uint64_t chunk = 0; ; chunk++) {
+        uint64_t slot = chunk % STREAM_READ_CHUNKS;
+        signal.wait([this, slot]{ return !chunk_ready[slot] || aborted; });
+        if(aborted) return;
+        ZSTD_outBuffer zout = {chunks[slot].data(), chunks[slot].size(), 0};
+        while(zout.pos < zout.size) {
+          if(sr.zin.pos >= sr.zin.size) {
+            sr.zin.pos = 0;
+            sr.zin.size = sr.read_reserve(sr.inblock.data(), sr.inblock.size(), false);
+          }
+          uint64_t bytes_decompressed = sr.ZSTD_decompressStream_count(sr.zds, &zout, &sr.zin);
+          if(sr.zin.size == 0 && bytes_decompressed == 0) break;
+        }
+        chunk_sizes[slot] = zout.pos;
+        chunk_ready[slot] = true;
+        signal.notify();
+        if(zout.pos < zout.size) return;
+      }
+    } catch(std::exception & e) {
+      error_message = e.what();
+      failed = true;
+      signal.notify();
+    }
+  }
+
+  // copies up to length bytes of decompressed data, fewer only at the end of the data
+  uint64_t pull(char * dst, const uint64_t length) {
+    uint64_t copied = 0;
+    while(copied < length) {
+      uint64_t slot = chunks_consumed % STREAM_READ_CHUNKS;
+      signal.wait([this, slot]{ return chunk_ready[slot] || failed; });
+      if(!chunk_ready[slot]) throw std::runtime_error(error_message);
+      uint64_t n = std::min(chunk_sizes[slot] - chunk_offset, length - copied);
+      std::memcpy(dst + copied, chunks[slot].data() + chunk_offset, n);
+      copied += n;
+      chunk_offset += n;
+      if(chunk_offset < chunks[slot].size()) {
+        if(chunk_offset == chunk_sizes[slot]) break; // last chunk
+        continue;
+      }
+      chunk_offset = 0;
+      chunks_consumed++;
+      chunk_ready[slot] = false;
+      signal.notify();
+    }
+    decompressed_bytes_read += copied;
+    return copied;
+  }
+  void getBlock() {
+    char * ptr = outblock.data();
+    uint64_t remaining = blocksize > blockoffset ? blocksize - blockoffset : 0;
+    if(remaining > 0) std::memmove(ptr, ptr + blockoffset, remaining);
+    blocksize = remaining + pull(ptr + remaining, outblock.size() - remaining);
+    blockoffset = 0;
+  }
+  void copyData(char* dst, uint64_t dst_size) {
+    char * ptr = outblock.data();
+    if(dst_size > blocksize - blockoffset) {
+      uint64_t buffered = blocksize - blockoffset;
+      std::memcpy(dst, ptr + blockoffset, buffered);
+      if(pull(dst + buffered, dst_size - buffered) != dst_size - buffered) {
+        throw std::runtime_error("zstd stream decompression error: unexpected end of data");
+      }
+      blockoffset = 0;
+      blocksize = 0;
+    } else {
+      std::memcpy(dst, ptr + blockoffset, dst_size);
+      blockoffset += dst_size;
+    }
+    if(blocksize - blockoffset < BLOCKRESERVE) {
+      getBlock();
+    }
+  }
+  // called after the object is read: consumes the rest of the stream so that the hash and byte count cover all of it
+  void finish() {
+    std::vector<char> discard(outblock.size());
+    while(pull(discard.data(), discard.size()) == discard.size()) {}
+    decompressor.join();
+  }
+};
+
 template <class stream_reader>
 struct uncompressed_streamRead {
   QsMetadata qm;
@@ -316,6 +438,8 @@ struct Data_Context_Stream {
   DestreamClass & dsc;
   bool use_alt_rep_bool;
   std::unordered_map<uint32_t, SEXP> object_ref_hash;
+  StringTable string_table; // see string_dedup_flag
+  ColumnarStringData columnar; // scratch space of readCharacterColumnar, reused for every vector read
   std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
   uint64_t & data_offset; // dsc.blockoffset
   uint64_t & block_size; // dsc.blocksize
@@ -327,6 +451,16 @@ struct Data_Context_Stream {
   void getBlock() {
     dsc.getBlock();
   }
+  // skip the zero padding before an aligned payload (see alignmentPadding)
+  void alignData(const uint64_t data_size) {
+    uint64_t position = dsc.decompressed_bytes_read - (block_size - data_offset);
+    uint64_t padding = alignmentPadding(qm, QS_HEADER_LENGTH + position, data_size);
+    if(padding > 0) getBlockData(tempBlock(padding), padding);
+  }
+  // lazy vectors need random access into the file (see Data_Context), always read eagerly
+  SEXP lazyVector(const SEXPTYPE type, const uint64_t length, const uint64_t bytesoftype, const bool shuffle) {
+    return R_NilValue;
+  }
   void getBlockData(char* outp, uint64_t data_size) {
     dsc.copyData(outp, data_size);
   }
@@ -367,3 +501,24 @@ struct Data_Context_Stream {
   }
 };
 
+
+// Data_Context_Stream for qinspect, counts the object headers and passes over the data (see inspectObject)
+template <class DestreamClass>
+struct Inspect_Context_Stream : public Data_Context_Stream<DestreamClass> {
+  std::vector<uint64_t> header_counts = std::vector<uint64_t>(QSTYPE_COUNT);
+  std::vector<char> skipblock = std::vector<char>(BLOCKSIZE);
+
+  Inspect_Context_Stream(DestreamClass & d, QsMetadata q) : Data_Context_Stream<DestreamClass>(d, q, false) {}
+
+  void readHeader(qstype & object_type, uint64_t & r_array_len) {
+    Data_Context_Stream<DestreamClass>::readHeader(object_type, r_array_len);
+    header_counts[static_cast<int>(object_type)]++;
+  }
+  void skipData(uint64_t data_size) {
+    while(data_size > 0) {
+      uint64_t len = std::min<uint64_t>(data_size, skipblock.size());
+      this->getBlockData(skipblock.data(), len);
+      data_size -= len;
+    }
+  }
+};
@@ -9,16 +9,17 @@
 
 // #define QS_DEBUG
 
-#ifdef QS_DEBUG
-std::string qtypestr(qstype x) {
+// also names the header types counted by qinspect
+inline std::string qtypestr(qstype x) {
   const std::string enum_strings[] = {
     "NUMERIC", "INTEGER", "LOGICAL", "CHARACTER", "NIL", "LIST", "COMPLEX", "RAW", "PAIRLIST", "LANG", "CLOS", "PROM", "DOT", "SYM",
     "PAIRLIST_WF", "LANG_WF", "CLOS_WF", "PROM_WF", "DOT_WF",
     "S4", "S4FLAG", "LOCKED_ENV", "UNLOCKED_ENV", "REFERENCE",
-    "ATTRIBUTE", "RSERIALIZED" };
+    "ATTRIBUTE", "RSERIALIZED",
+    "CHARACTER_DICT", "CHARACTER_COLUMNAR" };
   return enum_strings[(int)x];
 }
-#endif
+static constexpr int QSTYPE_COUNT = static_cast<int>(qstype::CHARACTER_COLUMNAR) + 1;
 
 inline void readHeader_common(qstype & object_type, uint64_t & r_array_len, uint64_t & data_offset, const char * const header) {
   uint8_t hd = reinterpret_cast<const uint8_t*>(header)[data_offset];
@@ -96,6 +97,16 @@ inline void readHeader_common(qstype & object_type, uint64_t & r_array_len, uint
       data_offset += 6;
       object_type = qstype::REFERENCE;
       return;
+    case character_dict_header:
+      r_array_len = unaligned_cast<uint64_t>(header, data_offset+2);
+      data_offset += 10;
+      object_type = qstype::CHARACTER_DICT;
+      return;
+    case character_columnar_header:
+      r_array_len = unaligned_cast<uint64_t>(header, data_offset+2);
+      data_offset += 10;
+      object_type = qstype::CHARACTER_COLUMNAR;
+      return;
     }
   }
   case sym_header:
@@ -284,6 +295,41 @@ inline void readHeader_common(qstype & object_type, uint64_t & r_array_len, uint
   // additional types
   throw std::runtime_error("something went wrong (reading object header)");
 }
+// strings of character vectors in files written with string_dedup (see string_dedup_flag and StringRefMap), in the order they were written
+// the CHARSXPs are held in a preserved character vector, strings that are passed over (e.g. by processAttributes) are not reachable otherwise
+struct StringTable {
+  SEXP strings = R_NilValue;
+  uint64_t size = 0;
+  StringTable() {}
+  StringTable(const StringTable &) = delete;
+  StringTable & operator=(const StringTable &) = delete;
+  ~StringTable() {
+    if(strings != R_NilValue) R_ReleaseObject(strings);
+  }
+  void add(SEXP const x) {
+    if(size == static_cast<uint64_t>(Rf_xlength(strings))) {
+      SEXP grown = PROTECT(Rf_allocVector(STRSXP, size < 1024 ? 1024 : 2*size));
+      for(uint64_t i=0; i<size; i++) SET_STRING_ELT(grown, i, STRING_ELT(strings, i));
+      R_PreserveObject(grown);
+      UNPROTECT(1);
+      if(strings != R_NilValue) R_ReleaseObject(strings);
+      strings = grown;
+    }
+    SET_STRING_ELT(strings, size, x);
+    size++;
+  }
+  // r_string_len as read by readStringHeader_common, with STRING_REF_BIT set
+  SEXP get(const uint32_t r_string_len) const {
+    uint64_t distance = r_string_len & ~STRING_REF_BIT;
+    if(distance == 0 || distance > size) throw std::runtime_error("invalid string reference, data is corrupted");
+    return STRING_ELT(strings, size - distance);
+  }
+};
+
+inline bool isStringRef(const uint32_t r_string_len) {
+  return r_string_len != NA_STRING_LENGTH && (r_string_len & STRING_REF_BIT);
+}
+
 inline void readStringHeader_common(uint32_t & r_string_len, cetype_t & ce_enc, uint64_t & data_offset, const char * const header) {
   uint8_t enc = reinterpret_cast<const uint8_t*>(header)[data_offset] & 0xC0;
   switch(enc) {
@@ -320,6 +366,18 @@ inline void readStringHeader_common(uint32_t & r_string_len, cetype_t & ce_enc,
       r_string_len = NA_STRING_LENGTH;
       data_offset += 1;
       return;
+    case string_header_ref_8:
+      r_string_len = STRING_REF_BIT | *reinterpret_cast<const uint8_t*>(header+data_offset+1);
+      data_offset += 2;
+      return;
+    case string_header_ref_16:
+      r_string_len = STRING_REF_BIT | unaligned_cast<uint16_t>(header, data_offset+1);
+      data_offset += 3;
+      return;
+    case string_header_ref_32:
+      r_string_len = STRING_REF_BIT | unaligned_cast<uint32_t>(header, data_offset+1);
+      data_offset += 5;
+      return;
     }
   }
   throw std::runtime_error("something went wrong (reading string header)");
@@ -329,8 +387,234 @@ inline void readFlags_common(int & packed_flags, uint64_t & data_offset, const c
   data_offset += 4;
 }
 
+// processBlock uses an explicit stack instead of recursion, so the nesting depth of an object is not limited by the C stack
+// A frame holds an object whose children or attributes are being read; the object and its attribute pairlist are protected
+// while the frame is on the stack, and completed children are set into the object of the frame below them
+struct ReadFrame {
+  SEXP obj;
+  SEXP cursor = R_NilValue; // pairlist cell of the next pairlist element or attribute
+  SEXP attributes = R_NilValue;
+  uint64_t children;
+  uint64_t number_of_attributes;
+  uint64_t next = 0; // next child, then next attribute
+  int packed_flags = 0; // flags of the current pairlist element, or of the object for LANG_WF etc.
+  qstype obj_type;
+  bool s4_flag;
+  bool class_attribute = false; // the current attribute is "class"
+};
+
+struct ReadStack {
+  std::vector<ReadFrame> frames;
+  int protected_count = 0;
+  ~ReadStack() {
+    if(protected_count > 0) UNPROTECT(protected_count);
+  }
+  SEXP protect(SEXP x) {
+    PROTECT(x);
+    protected_count++;
+    return x;
+  }
+  void unprotect() {
+    UNPROTECT(1);
+    protected_count--;
+  }
+  // obj must be the last object protected
+  void push(SEXP obj, const qstype obj_type, const uint64_t children, const uint64_t number_of_attributes, const bool s4_flag) {
+    ReadFrame f;
+    f.obj = obj;
+    f.obj_type = obj_type;
+    f.children = children;
+    f.number_of_attributes = number_of_attributes;
+    f.s4_flag = s4_flag;
+    frames.push_back(f);
+  }
+};
+
+// reads a string of a character vector (see writeString), the CHARSXP is not protected
 template <class T>
-SEXP processBlock(T * const sobj) {
+SEXP readString(T * const sobj, std::string & temp_string) {
+  uint32_t r_string_len;
+  cetype_t string_encoding;
+  sobj->readStringHeader(r_string_len, string_encoding);
+#ifdef QS_DEBUG
+  std::cout << "string " << r_string_len << " " << (int)string_encoding << std::endl;
+#endif
+  if(r_string_len == NA_STRING_LENGTH) return NA_STRING;
+  if(r_string_len == 0) return R_BlankString;
+  if(isStringRef(r_string_len)) return sobj->string_table.get(r_string_len);
+  if(r_string_len > temp_string.size()) temp_string.resize(r_string_len);
+  sobj->getBlockData(&temp_string[0], r_string_len);
+  SEXP xi = Rf_mkCharLenCE(temp_string.c_str(), r_string_len, string_encoding);
+  if(sobj->qm.string_dedup) {
+    PROTECT(xi);
+    sobj->string_table.add(xi);
+    UNPROTECT(1);
+  }
+  return xi;
+}
+
+// codes of a CHARACTER_DICT vector (see CharacterDictionary)
+template <class T>
+void readDictCodes(T * const sobj, const uint8_t nbits, const uint64_t length, std::vector<uint32_t> & codes) {
+  codes.resize(length);
+  switch(nbits) {
+  case 0:
+    std::fill(codes.begin(), codes.end(), 0);
+    return;
+  case 1:
+  case 2:
+  case 4:
+  case 8:
+  {
+    std::vector<uint8_t> packed((length * nbits + 7) / 8);
+    sobj->getBlockData(reinterpret_cast<char*>(packed.data()), packed.size());
+    uint8_t mask = static_cast<uint8_t>((1U << nbits) - 1);
+    for(uint64_t i=0; i<length; i++) {
+      codes[i] = (packed[(i*nbits) >> 3] >> ((i*nbits) & 7)) & mask;
+    }
+    return;
+  }
+  case 16:
+  {
+    std::vector<uint16_t> packed(length);
+    if(sobj->qm.int_shuffle) {
+      sobj->getShuffleBlockData(reinterpret_cast<char*>(packed.data()), length*2, 2);
+    } else {
+      sobj->getBlockData(reinterpret_cast<char*>(packed.data()), length*2);
+    }
+    std::copy(packed.begin(), packed.end(), codes.begin());
+    return;
+  }
+  case 32:
+    if(sobj->qm.int_shuffle) {
+      sobj->getShuffleBlockData(reinterpret_cast<char*>(codes.data()), length*4, 4);
+    } else {
+      sobj->getBlockData(reinterpret_cast<char*>(codes.data()), length*4);
+    }
+    return;
+  default:
+    throw std::runtime_error("invalid code width of dictionary encoded character vector, data is corrupted");
+  }
+}
+
+// reads the rest of a CHARACTER_DICT vector of length r_array_len into obj, an allocated STRSXP
+template <class T>
+void readCharacterDict(T * const sobj, SEXP const obj, const uint64_t r_array_len) {
+  uint8_t nbits;
+  uint32_t dict_size;
+  sobj->getBlockData(reinterpret_cast<char*>(&nbits), 1);
+  sobj->getBlockData(reinterpret_cast<char*>(&dict_size), 4);
+  SEXP dict = PROTECT(Rf_allocVector(STRSXP, dict_size));
+  std::string temp_string;
+  for(uint32_t j=0; j<dict_size; j++) {
+    SET_STRING_ELT(dict, j, readString(sobj, temp_string));
+  }
+  std::vector<uint32_t> codes;
+  readDictCodes(sobj, nbits, r_array_len, codes);
+  for(uint64_t i=0; i<r_array_len; i++) {
+    if(codes[i] >= dict_size) {
+      UNPROTECT(1);
+      throw std::runtime_error("invalid code in dictionary encoded character vector, data is corrupted");
+    }
+    SET_STRING_ELT(obj, i, STRING_ELT(dict, codes[i]));
+  }
+  UNPROTECT(1);
+}
+
+// the lengths, encodings and bytes of a CHARACTER_COLUMNAR vector of length n (see writeCharacterColumnar)
+// each reader context keeps one (columnar), so the buffers only grow to the longest vector read
+struct ColumnarStringData {
+  std::vector<uint32_t> lengths;
+  std::vector<uint8_t> encodings;
+  std::vector<char> blob;
+  template <class T>
+  void read(T * const sobj, const uint64_t n) {
+    uint8_t common_encoding;
+    sobj->getBlockData(reinterpret_cast<char*>(&common_encoding), 1);
+    lengths.resize(n);
+    if(sobj->qm.int_shuffle) {
+      sobj->getShuffleBlockData(reinterpret_cast<char*>(lengths.data()), n*4, 4);
+    } else {
+      sobj->getBlockData(reinterpret_cast<char*>(lengths.data()), n*4);
+    }
+    if(common_encoding == COLUMNAR_MIXED_ENCODINGS) {
+      encodings.resize(n);
+      sobj->getBlockData(reinterpret_cast<char*>(encodings.data()), n);
+    } else {
+      encodings.assign(n, common_encoding);
+    }
+    uint64_t blob_size;
+    sobj->getBlockData(reinterpret_cast<char*>(&blob_size), 8);
+    uint64_t total = 0;
+    for(uint64_t i=0; i<n; i++) {
+      if(encodings[i] > CE_BYTES) throw std::runtime_error("invalid string encoding, data is corrupted");
+      if(lengths[i] != NA_STRING_LENGTH && !isStringRef(lengths[i])) total += lengths[i];
+    }
+    if(total != blob_size) throw std::runtime_error("string lengths do not match the string data, data is corrupted");
+    blob.resize(blob_size);
+    if(blob_size > 0) sobj->getBlockData(blob.data(), blob_size);
+  }
+};
+
+// reads the rest of a CHARACTER_COLUMNAR vector, returns an unprotected STRSXP (an sf_vector if use_alt_rep)
+template <class T>
+SEXP readCharacterColumnar(T * const sobj, const uint64_t r_array_len) {
+  ColumnarStringData & cs = sobj->columnar;
+  cs.read(sobj, r_array_len);
+  uint64_t offset = 0;
+#ifdef USE_ALT_REP
+  if(sobj->use_alt_rep_bool) {
+    SEXP obj = PROTECT(sf_vector(r_array_len));
+    auto & ref = sf_vec_data_ref(obj);
+    for(uint64_t i=0; i<r_array_len; i++) {
+      uint32_t r_string_len = cs.lengths[i];
+      if(r_string_len == NA_STRING_LENGTH) {
+        ref[i] = sfstring(NA_STRING);
+      } else if(isStringRef(r_string_len)) {
+        ref[i] = sfstring(sobj->string_table.get(r_string_len));
+      } else if(r_string_len == 0) {
+        ref[i] = sfstring();
+      } else {
+        cetype_t string_encoding = static_cast<cetype_t>(cs.encodings[i]);
+        ref[i] = sfstring(r_string_len);
+        std::memcpy(&ref[i].sdata[0], cs.blob.data() + offset, r_string_len);
+        ref[i].check_if_native_is_ascii(string_encoding);
+        // later references need the CHARSXP
+        if(sobj->qm.string_dedup) {
+          SEXP xi = PROTECT(Rf_mkCharLenCE(cs.blob.data() + offset, r_string_len, string_encoding));
+          sobj->string_table.add(xi);
+          UNPROTECT(1);
+        }
+        offset += r_string_len;
+      }
+    }
+    UNPROTECT(1);
+    return obj;
+  }
+#endif
+  SEXP obj = PROTECT(Rf_allocVector(STRSXP, r_array_len));
+  for(uint64_t i=0; i<r_array_len; i++) {
+    uint32_t r_string_len = cs.lengths[i];
+    if(r_string_len == NA_STRING_LENGTH) {
+      SET_STRING_ELT(obj, i, NA_STRING);
+    } else if(isStringRef(r_string_len)) {
+      SET_STRING_ELT(obj, i, sobj->string_table.get(r_string_len));
+    } else if(r_string_len == 0) {
+      SET_STRING_ELT(obj, i, R_BlankString);
+    } else {
+      SET_STRING_ELT(obj, i, Rf_mkCharLenCE(cs.blob.data() + offset, r_string_len, static_cast<cetype_t>(cs.encodings[i])));
+      if(sobj->qm.string_dedup) sobj->string_table.add(STRING_ELT(obj, i));
+      offset += r_string_len;
+    }
+  }
+  UNPROTECT(1);
+  return obj;
+}
+
+// reads the next object: objects without children or attributes are read completely into obj and true is returned,
+// otherwise a frame is pushed onto rs and false is returned
+template <class T>
+bool processBlockStep(T * const sobj, ReadStack & rs, SEXP & obj) {
   qstype obj_type;
   uint64_t r_array_len;
   uint64_t number_of_attributes = 0;
@@ -353,149 +637,64 @@ SEXP processBlock(T * const sobj) {
     std::cout << qtypestr(obj_type) << " " << r_array_len << std::endl;
 #endif
   }
-  SEXP obj;
-  Protect_Tracker pt = Protect_Tracker();
   switch(obj_type) {
   case qstype::REFERENCE:
-    return sobj->object_ref_hash.at(static_cast<uint32_t>(r_array_len));
+    obj = sobj->object_ref_hash.at(static_cast<uint32_t>(r_array_len));
+    return true;
   case qstype::PAIRLIST:
-  {
-    obj = PROTECT(Rf_allocList(r_array_len)); pt++;
-    SEXP obj_i = obj;
-    for(uint64_t i=0; i<r_array_len; i++) {
-      uint32_t r_string_len;
-      cetype_t string_encoding;
-      sobj->readStringHeader(r_string_len, string_encoding);
-#ifdef QS_DEBUG
-      std::cout << "pairlist name string " << r_string_len << " " << (int)string_encoding << std::endl;
-#endif
-      if(r_string_len != NA_STRING_LENGTH) {
-        SET_TAG(obj_i, Rf_install(sobj->getString(r_string_len).c_str()));
-      }
-      SETCAR(obj_i, processBlock(sobj));
-      obj_i = CDR(obj_i);
-    }
-  }
-    break;
+  case qstype::PAIRLIST_WF:
+    obj = rs.protect(Rf_allocList(r_array_len));
+    rs.push(obj, obj_type, r_array_len, number_of_attributes, s4_flag);
+    rs.frames.back().cursor = obj;
+    return false;
   case qstype::LANG:
   case qstype::CLOS:
   case qstype::PROM:
   case qstype::DOT:
-  {
-    switch(obj_type) {
-  case qstype::LANG:
-    PROTECT(obj = Rf_allocSExp(LANGSXP)); pt++;
-    break;
-  case qstype::CLOS:
-    PROTECT(obj = Rf_allocSExp(CLOSXP)); pt++;
-    break;
-  case qstype::PROM:
-    PROTECT(obj = Rf_allocSExp(PROMSXP)); pt++;
-    break;
-  case qstype::DOT:
-    PROTECT(obj = Rf_allocSExp(DOTSXP)); pt++;
-    break;
-  default:
-    throw std::runtime_error("."); // add default to hush compiler warnings
-  }
-    SET_TAG(obj, processBlock(sobj));
-    SETCAR(obj, processBlock(sobj));
-    SETCDR(obj, processBlock(sobj));
-    if(obj_type == qstype::CLOS && CLOENV(obj) == R_NilValue) {
-      SET_CLOENV(obj, R_BaseEnv);
-    } else if(obj_type == qstype::PROM && PRENV(obj) == R_NilValue) {
-      SET_PRENV(obj, R_BaseEnv);
-    }
-  }
-    break;
-  case qstype::PAIRLIST_WF:
-  {
-    obj = PROTECT(Rf_allocList(r_array_len)); pt++;
-    SEXP obj_i = obj;
-    for(uint64_t i=0; i<r_array_len; i++) {
-      int packed_flags;
-      sobj->readFlags(packed_flags);
-      uint32_t r_string_len;
-      cetype_t string_encoding;
-      sobj->readStringHeader(r_string_len, string_encoding);
-#ifdef QS_DEBUG
-      std::cout << "pairlist name string " << r_string_len << " " << (int)string_encoding << std::endl;
-#endif
-      if(r_string_len != NA_STRING_LENGTH) {
-        SET_TAG(obj_i, Rf_install(sobj->getString(r_string_len).c_str()));
-      }
-      SETCAR(obj_i, processBlock(sobj));
-      unpackFlags(obj_i, packed_flags);
-      obj_i = CDR(obj_i);
-    }
-  }
-    break;
   case qstype::LANG_WF:
   case qstype::CLOS_WF:
   case qstype::PROM_WF:
   case qstype::DOT_WF:
-  {
     switch(obj_type) {
-  case qstype::LANG_WF:
-    PROTECT(obj = Rf_allocSExp(LANGSXP)); pt++;
-    break;
-  case qstype::CLOS_WF:
-    PROTECT(obj = Rf_allocSExp(CLOSXP)); pt++;
-    break;
-  case qstype::PROM_WF:
-    PROTECT(obj = Rf_allocSExp(PROMSXP)); pt++;
-    break;
-  case qstype::DOT_WF:
-    PROTECT(obj = Rf_allocSExp(DOTSXP)); pt++;
-    break;
-  default:
-    throw std::runtime_error("."); // add default to hush compiler warnings
-  }
-    SET_TAG(obj, processBlock(sobj));
-    SETCAR(obj, processBlock(sobj));
-    SETCDR(obj, processBlock(sobj));
-    if(obj_type == qstype::CLOS && CLOENV(obj) == R_NilValue) {
-      SET_CLOENV(obj, R_BaseEnv);
-    } else if(obj_type == qstype::PROM && PRENV(obj) == R_NilValue) {
-      SET_PRENV(obj, R_BaseEnv);
+    case qstype::LANG:
+    case qstype::LANG_WF:
+      obj = rs.protect(Rf_allocSExp(LANGSXP));
+      break;
+    case qstype::CLOS:
+    case qstype::CLOS_WF:
+      obj = rs.protect(Rf_allocSExp(CLOSXP));
+      break;
+    case qstype::PROM:
+    case qstype::PROM_WF:
+      obj = rs.protect(Rf_allocSExp(PROMSXP));
+      break;
+    default:
+      obj = rs.protect(Rf_allocSExp(DOTSXP));
+      break;
     }
-    unpackFlags(obj, static_cast<int>(r_array_len));
-  }
-    break;
+    rs.push(obj, obj_type, 3, number_of_attributes, s4_flag); // TAG, CAR, CDR
+    rs.frames.back().packed_flags = static_cast<int>(r_array_len);
+    return false;
   case qstype::UNLOCKED_ENV:
   case qstype::LOCKED_ENV:
-  {
-    obj = PROTECT(Rf_allocSExp(ENVSXP)); pt++;
+    obj = rs.protect(Rf_allocSExp(ENVSXP));
     sobj->object_ref_hash.emplace(static_cast<uint32_t>(r_array_len), obj);
-    SET_ENCLOS(obj, processBlock(sobj));
-    SET_FRAME(obj, processBlock(sobj));
-    SET_HASHTAB(obj, processBlock(sobj));
-    // R_RestoreHashCount(obj); // doesn't exist in new API; the function sets truelength to the number of filled hash slots
-    SEXP table = HASHTAB(obj);
-    if(table != R_NilValue) {
-      int size = Rf_xlength(table);
-      int count = 0;
-      for(int i = 0; i < size; ++i) {
-        if(VECTOR_ELT(table, i) != R_NilValue) ++count;
-      }
-      SET_TRUELENGTH(table, count);
-    }
-    if(obj_type == qstype::LOCKED_ENV) R_LockEnvironment(obj, FALSE);
-    if(ENCLOS(obj) == R_NilValue) SET_ENCLOS(obj, R_BaseEnv);
-  }
-    break;
+    rs.push(obj, obj_type, 3, number_of_attributes, s4_flag); // ENCLOS, FRAME, HASHTAB
+    return false;
   case qstype::S4:
     // obj = PROTECT(Rf_allocS4Object()); pt++; // S4 object may not have S4 flag
-    obj = PROTECT(Rf_allocSExp(S4SXP)); pt++;
+    obj = rs.protect(Rf_allocSExp(S4SXP));
     break;
   case qstype::LIST:
-    obj = PROTECT(Rf_allocVector(VECSXP, r_array_len)); pt++;
-    for(uint64_t i=0; i<r_array_len; i++) {
-      SET_VECTOR_ELT(obj, i, processBlock(sobj));
-    }
-    break;
+    obj = rs.protect(Rf_allocVector(VECSXP, r_array_len));
+    rs.push(obj, obj_type, r_array_len, number_of_attributes, s4_flag);
+    return false;
   case qstype::NUMERIC:
-    obj = PROTECT(Rf_allocVector(REALSXP, r_array_len)); pt++;
+    sobj->alignData(r_array_len*8);
+    obj = rs.protect(sobj->lazyVector(REALSXP, r_array_len, 8, sobj->qm.real_shuffle));
+    if(obj != R_NilValue) break;
+    rs.unprotect();
+    obj = rs.protect(Rf_allocVector(REALSXP, r_array_len));
     if(sobj->qm.real_shuffle) {
       sobj->getShuffleBlockData(reinterpret_cast<char*>(REAL(obj)), r_array_len*8, 8);
     } else {
@@ -503,7 +702,11 @@ SEXP processBlock(T * const sobj) {
     }
     break;
   case qstype::INTEGER:
-    obj = PROTECT(Rf_allocVector(INTSXP, r_array_len)); pt++;
+    sobj->alignData(r_array_len*4);
+    obj = rs.protect(sobj->lazyVector(INTSXP, r_array_len, 4, sobj->qm.int_shuffle));
+    if(obj != R_NilValue) break;
+    rs.unprotect();
+    obj = rs.protect(Rf_allocVector(INTSXP, r_array_len));
     if(sobj->qm.int_shuffle) {
       sobj->getShuffleBlockData(reinterpret_cast<char*>(INTEGER(obj)), r_array_len*4, 4);
     } else {
@@ -511,7 +714,11 @@ SEXP processBlock(T * const sobj) {
     }
     break;
   case qstype::LOGICAL:
-    obj = PROTECT(Rf_allocVector(LGLSXP, r_array_len)); pt++;
+    sobj->alignData(r_array_len*4);
+    obj = rs.protect(sobj->lazyVector(LGLSXP, r_array_len, 4, sobj->qm.lgl_shuffle));
+    if(obj != R_NilValue) break;
+    rs.unprotect();
+    obj = rs.protect(Rf_allocVector(LGLSXP, r_array_len));
     if(sobj->qm.lgl_shuffle) {
       sobj->getShuffleBlockData(reinterpret_cast<char*>(LOGICAL(obj)), r_array_len*4, 4);
     } else {
@@ -519,7 +726,8 @@ SEXP processBlock(T * const sobj) {
     }
     break;
   case qstype::COMPLEX:
-    obj = PROTECT(Rf_allocVector(CPLXSXP, r_array_len)); pt++;
+    sobj->alignData(r_array_len*16);
+    obj = rs.protect(Rf_allocVector(CPLXSXP, r_array_len));
     if(sobj->qm.cplx_shuffle) {
       sobj->getShuffleBlockData(reinterpret_cast<char*>(COMPLEX(obj)), r_array_len*16, 8);
     } else {
@@ -527,13 +735,16 @@ SEXP processBlock(T * const sobj) {
     }
     break;
   case qstype::RAW:
-    obj = PROTECT(Rf_allocVector(RAWSXP, r_array_len)); pt++;
+    obj = rs.protect(sobj->lazyVector(RAWSXP, r_array_len, 1, false));
+    if(obj != R_NilValue) break;
+    rs.unprotect();
+    obj = rs.protect(Rf_allocVector(RAWSXP, r_array_len));
     if(r_array_len > 0) sobj->getBlockData(reinterpret_cast<char*>(RAW(obj)), r_array_len);
     break;
   case qstype::CHARACTER:
 #ifdef USE_ALT_REP
     if(sobj->use_alt_rep_bool) {
-      obj = PROTECT(sf_vector(r_array_len)); pt++;
+      obj = rs.protect(sf_vector(r_array_len));
       auto & ref = sf_vec_data_ref(obj);
       for(uint64_t i=0; i < r_array_len; i++) {
         uint32_t r_string_len;
@@ -544,6 +755,8 @@ SEXP processBlock(T * const sobj) {
 #endif
         if(r_string_len == NA_STRING_LENGTH) {
           ref[i] = sfstring(NA_STRING);
+        } else if(isStringRef(r_string_len)) {
+          ref[i] = sfstring(sobj->string_table.get(r_string_len));
         } else {
           if(r_string_len == 0) {
             ref[i] = sfstring();
@@ -551,6 +764,12 @@ SEXP processBlock(T * const sobj) {
             ref[i] = sfstring(r_string_len);
             sobj->getBlockData(&ref[i].sdata[0], r_string_len);
             ref[i].check_if_native_is_ascii(string_encoding);
+            // later references need the CHARSXP
+            if(sobj->qm.string_dedup) {
+              SEXP xi = PROTECT(Rf_mkCharLenCE(ref[i].sdata.c_str(), r_string_len, string_encoding));
+              sobj->string_table.add(xi);
+              UNPROTECT(1);
+            }
 #ifdef QS_DEBUG
             std::cout << ref[i].sdata;
 #endif
@@ -562,32 +781,26 @@ SEXP processBlock(T * const sobj) {
       }
     } else {
 #endif
-      obj = PROTECT(Rf_allocVector(STRSXP, r_array_len)); pt++;
+      obj = rs.protect(Rf_allocVector(STRSXP, r_array_len));
       // for long character vectors, re-using a temporary string is faster
       // we also don't need to always resize to have a trailing \0,
       // since we pass in the string length. This is an important perf optimization
       std::string temp_string;
       for(uint64_t i=0; i<r_array_len; i++) {
-        uint32_t r_string_len;
-        cetype_t string_encoding;
-        sobj->readStringHeader(r_string_len, string_encoding);
-#ifdef QS_DEBUG
-        std::cout << "string " << r_string_len << " " << (int)string_encoding << std::endl;
-#endif
-        if(r_string_len == NA_STRING_LENGTH) {
-          SET_STRING_ELT(obj, i, NA_STRING);
-        } else if(r_string_len == 0) {
-          SET_STRING_ELT(obj, i, R_BlankString);
-        } else if(r_string_len > 0) {
-          if(r_string_len > temp_string.size()) temp_string.resize(r_string_len);
-          sobj->getBlockData(&temp_string[0], r_string_len);
-          SET_STRING_ELT(obj, i, Rf_mkCharLenCE(temp_string.c_str(), r_string_len, string_encoding));
-        }
+        SET_STRING_ELT(obj, i, readString(sobj, temp_string));
       }
 #ifdef USE_ALT_REP
     }
 #endif
     break;
+  case qstype::CHARACTER_DICT:
+    // the elements share the CHARSXPs of the dictionary, so an ALTREP vector would not save anything
+    obj = rs.protect(Rf_allocVector(STRSXP, r_array_len));
+    readCharacterDict(sobj, obj, r_array_len);
+    break;
+  case qstype::CHARACTER_COLUMNAR:
+    obj = rs.protect(readCharacterColumnar(sobj, r_array_len));
+    break;
   case qstype::SYM:
   {
     uint32_t r_string_len;
@@ -599,53 +812,159 @@ SEXP processBlock(T * const sobj) {
 #endif
     // there is some difference between Rf_installChar and Rf_install, as Rf_installChar will translate to native encoding
     // Use PROTECT since serialize.c does; not clear if necessary
-    obj = PROTECT(Rf_mkCharLenCE(sobj->getString(r_string_len).c_str(), r_string_len, string_encoding)); pt++;
-    obj = Rf_installChar(obj); //Rf_installTrChar in R 4.0.0
+    SEXP sym_char = rs.protect(Rf_mkCharLenCE(sobj->getString(r_string_len).c_str(), r_string_len, string_encoding));
+    obj = Rf_installChar(sym_char); //Rf_installTrChar in R 4.0.0
+    rs.unprotect();
+    rs.protect(obj);
   }
     break;
   case qstype::RSERIALIZED:
   {
-    SEXP obj_data = PROTECT(Rf_allocVector(RAWSXP, r_array_len)); pt++;
+    SEXP obj_data = rs.protect(Rf_allocVector(RAWSXP, r_array_len));
     sobj->getBlockData(reinterpret_cast<char*>(RAW(obj_data)), r_array_len);
-    obj = PROTECT(R::unserializeFromRaw(obj_data)); pt++;
-    return obj;
+    obj = R::unserializeFromRaw(obj_data);
+    rs.unprotect();
+    return true;
   }
   default: // also NILSXP
     obj = R_NilValue;
-    return obj;
+    return true;
   }
+  // vectors, symbols and S4 objects, obj is protected
   if(number_of_attributes > 0) {
-    SEXP attrib_pairlist = PROTECT(Rf_allocList(number_of_attributes)); pt++;
-    SEXP aptr = attrib_pairlist;
-    for(uint64_t i=0; i<number_of_attributes; i++) {
-      uint32_t r_string_len;
-      cetype_t string_encoding;
-      sobj->readStringHeader(r_string_len, string_encoding);
-      std::string attr_string = sobj->getString(r_string_len);
+    rs.push(obj, obj_type, 0, number_of_attributes, s4_flag);
+    return false;
+  }
+  if(s4_flag) SET_S4_OBJECT(obj);
+  rs.unprotect();
+  return true;
+}
+
+// reads the pairlist tag or attribute name that precedes the next child of f
+template <class T>
+void processChildPrefix(T * const sobj, ReadStack & rs, ReadFrame & f) {
+  if(f.next < f.children) {
+    if(f.obj_type != qstype::PAIRLIST && f.obj_type != qstype::PAIRLIST_WF) return;
+    if(f.obj_type == qstype::PAIRLIST_WF) sobj->readFlags(f.packed_flags);
+    uint32_t r_string_len;
+    cetype_t string_encoding;
+    sobj->readStringHeader(r_string_len, string_encoding);
 #ifdef QS_DEBUG
-      std::cout << "attr string " << r_string_len << " " << (int)string_encoding << " "  << attr_string << std::endl;
+    std::cout << "pairlist name string " << r_string_len << " " << (int)string_encoding << std::endl;
 #endif
-      // Is protect needed here?
-      // I believe it is not, since SET_TAG/SETCAR shouldn't allocate and serialize.c doesn't protect either
-      // What about IS_CHARACTER?
-      SET_TAG(aptr, Rf_install(attr_string.c_str()));
-      if( strcmp(attr_string.c_str(), "class") == 0 ) {
-        SEXP aobj = PROTECT(processBlock(sobj)); pt++;
-        if((IS_CHARACTER(aobj)) & (Rf_xlength(aobj) >= 1)) {
-          SET_OBJECT(obj, 1);
-        }
-        SETCAR(aptr, aobj);
-      } else {
-        SETCAR(aptr, processBlock(sobj));
+    if(r_string_len != NA_STRING_LENGTH) {
+      SET_TAG(f.cursor, Rf_install(sobj->getString(r_string_len).c_str()));
+    }
+  } else {
+    if(f.next == f.children) {
+      f.attributes = rs.protect(Rf_allocList(f.number_of_attributes));
+      f.cursor = f.attributes;
+    }
+    uint32_t r_string_len;
+    cetype_t string_encoding;
+    sobj->readStringHeader(r_string_len, string_encoding);
+    std::string attr_string = sobj->getString(r_string_len);
+#ifdef QS_DEBUG
+    std::cout << "attr string " << r_string_len << " " << (int)string_encoding << " "  << attr_string << std::endl;
+#endif
+    // Is protect needed here?
+    // I believe it is not, since SET_TAG/SETCAR shouldn't allocate and serialize.c doesn't protect either
+    SET_TAG(f.cursor, Rf_install(attr_string.c_str()));
+    f.class_attribute = strcmp(attr_string.c_str(), "class") == 0;
+  }
+}
+
+// sets a completed child (number f.next - 1) into the object of f
+inline void setChild(ReadFrame & f, SEXP const child) {
+  uint64_t i = f.next - 1;
+  if(i >= f.children) {
+    // What about IS_CHARACTER?
+    if(f.class_attribute && (IS_CHARACTER(child)) & (Rf_xlength(child) >= 1)) {
+      SET_OBJECT(f.obj, 1);
+    }
+    SETCAR(f.cursor, child);
+    f.cursor = CDR(f.cursor);
+    return;
+  }
+  switch(f.obj_type) {
+  case qstype::LIST:
+    SET_VECTOR_ELT(f.obj, i, child);
+    break;
+  case qstype::PAIRLIST:
+  case qstype::PAIRLIST_WF:
+    SETCAR(f.cursor, child);
+    if(f.obj_type == qstype::PAIRLIST_WF) unpackFlags(f.cursor, f.packed_flags);
+    f.cursor = CDR(f.cursor);
+    break;
+  case qstype::UNLOCKED_ENV:
+  case qstype::LOCKED_ENV:
+    if(i == 0) {
+      SET_ENCLOS(f.obj, child);
+    } else if(i == 1) {
+      SET_FRAME(f.obj, child);
+    } else {
+      SET_HASHTAB(f.obj, child);
+    }
+    break;
+  default: // LANG, CLOS, PROM, DOT with or without flags
+    if(i == 0) {
+      SET_TAG(f.obj, child);
+    } else if(i == 1) {
+      SETCAR(f.obj, child);
+    } else {
+      SETCDR(f.obj, child);
+    }
+    break;
+  }
+}
+
+// finishes the object of the top frame after all children and attributes are read, and pops the frame
+inline SEXP finishFrame(ReadStack & rs) {
+  ReadFrame & f = rs.frames.back();
+  SEXP obj = f.obj;
+  switch(f.obj_type) {
+  case qstype::CLOS:
+    if(CLOENV(obj) == R_NilValue) SET_CLOENV(obj, R_BaseEnv);
+    break;
+  case qstype::PROM:
+    if(PRENV(obj) == R_NilValue) SET_PRENV(obj, R_BaseEnv);
+    break;
+  case qstype::LANG_WF:
+  case qstype::CLOS_WF:
+  case qstype::PROM_WF:
+  case qstype::DOT_WF:
+    unpackFlags(obj, f.packed_flags);
+    break;
+  case qstype::UNLOCKED_ENV:
+  case qstype::LOCKED_ENV:
+  {
+    // R_RestoreHashCount(obj); // doesn't exist in new API; the function sets truelength to the number of filled hash slots
+    SEXP table = HASHTAB(obj);
+    if(table != R_NilValue) {
+      int size = Rf_xlength(table);
+      int count = 0;
+      for(int i = 0; i < size; ++i) {
+        if(VECTOR_ELT(table, i) != R_NilValue) ++count;
       }
-      aptr = CDR(aptr);
+      SET_TRUELENGTH(table, count);
     }
-    SET_ATTRIB(obj, attrib_pairlist);
+    if(f.obj_type == qstype::LOCKED_ENV) R_LockEnvironment(obj, FALSE);
+    if(ENCLOS(obj) == R_NilValue) SET_ENCLOS(obj, R_BaseEnv);
   }
-  if(s4_flag) {
+    break;
+  default:
+    break;
+  }
+  if(f.number_of_attributes > 0) {
+    SET_ATTRIB(obj, f.attributes);
+    rs.unprotect(); // attributes
+  }
+  if(f.s4_flag) {
     SET_S4_OBJECT(obj);
     // SET_OBJECT(obj, 1); // this flag seems kind of pointless
   }
+  rs.unprotect(); // obj
+  rs.frames.pop_back();
   if( !trust_promises_global && (TYPEOF(obj) == PROMSXP)) {
     Rcpp::warning("PROMSXP detected, replacing with NULL (see https://github.com/qsbase/qs/issues/93)");
     return R_NilValue;
@@ -654,6 +973,126 @@ SEXP processBlock(T * const sobj) {
   }
 }
 
+template <class T>
+SEXP processBlock(T * const sobj) {
+  ReadStack rs;
+  SEXP obj;
+  if(processBlockStep(sobj, rs, obj)) return obj;
+  while(true) {
+    ReadFrame & f = rs.frames.back();
+    if(f.next < f.children + f.number_of_attributes) {
+      processChildPrefix(sobj, rs, f);
+      f.next++;
+      if(!processBlockStep(sobj, rs, obj)) continue; // f is invalidated, a frame was pushed for the child
+    } else {
+      obj = finishFrame(rs);
+      if(rs.frames.empty()) return obj;
+    }
+    setChild(rs.frames.back(), obj);
+  }
+}
+
+
+// reads number_of_attributes (name, object) pairs into a tagged pairlist, c.f. ATTRIB(x)
+// same format as the attribute section read at the end of processBlock
+template <class T>
+SEXP processAttributeList(T * const sobj, const uint64_t number_of_attributes) {
+  Protect_Tracker pt = Protect_Tracker();
+  SEXP attrib_pairlist = PROTECT(Rf_allocList(number_of_attributes)); pt++;
+  SEXP aptr = attrib_pairlist;
+  for(uint64_t i=0; i<number_of_attributes; i++) {
+    uint32_t r_string_len;
+    cetype_t string_encoding;
+    sobj->readStringHeader(r_string_len, string_encoding);
+    std::string attr_string = sobj->getString(r_string_len);
+    SET_TAG(aptr, Rf_install(attr_string.c_str()));
+    SETCAR(aptr, processBlock(sobj));
+    aptr = CDR(aptr);
+  }
+  return attrib_pairlist;
+}
+
+// converts user supplied list elements (names or 1-based positions) to 0-based positions
+// attributes is the attribute pairlist of the list, used to look up element names
+inline std::vector<uint64_t> selectElements(SEXP const elements, const uint64_t length, SEXP const attributes) {
+  std::vector<uint64_t> selected(Rf_xlength(elements));
+  switch(TYPEOF(elements)) {
+  case STRSXP:
+  {
+    SEXP names = R_NilValue;
+    for(SEXP aptr = attributes; aptr != R_NilValue; aptr = CDR(aptr)) {
+      if(TAG(aptr) == R_NamesSymbol) names = CAR(aptr);
+    }
+    if(TYPEOF(names) != STRSXP) throw std::runtime_error("object does not have names");
+    // names are translated once; emplace keeps the first of duplicated names, like `[`
+    std::unordered_map<std::string, uint64_t> name_index;
+    name_index.reserve(length);
+    for(uint64_t j=0; j<length; j++) {
+      SEXP nj = STRING_ELT(names, j);
+      if(nj != NA_STRING) name_index.emplace(Rf_translateCharUTF8(nj), j);
+    }
+    for(uint64_t i=0; i<selected.size(); i++) {
+      SEXP ei = STRING_ELT(elements, i);
+      auto it = ei == NA_STRING ? name_index.end() : name_index.find(Rf_translateCharUTF8(ei));
+      if(it == name_index.end()) throw std::runtime_error(std::string("element not found: ") + (ei == NA_STRING ? "NA" : CHAR(ei)));
+      selected[i] = it->second;
+    }
+    return selected;
+  }
+  case INTSXP:
+  case REALSXP:
+  {
+    for(uint64_t i=0; i<selected.size(); i++) {
+      double ei = TYPEOF(elements) == INTSXP ? (INTEGER(elements)[i] == NA_INTEGER ? 0 : INTEGER(elements)[i]) : REAL(elements)[i];
+      if(!(ei >= 1 && ei <= static_cast<double>(length))) throw std::runtime_error("element position out of range");
+      selected[i] = static_cast<uint64_t>(ei) - 1;
+    }
+    return selected;
+  }
+  default:
+    throw std::runtime_error("elements must be a character or numeric vector");
+  }
+}
+
+// sets attributes of a list made from a subset of elements of another list
+// names are subset; a data.frame keeps its remaining attributes (class, row.names, ...), other lists only keep names
+inline void setSubsetAttributes(SEXP const x, SEXP const attributes, const std::vector<uint64_t> & selected) {
+  bool is_data_frame = false;
+  for(SEXP aptr = attributes; aptr != R_NilValue; aptr = CDR(aptr)) {
+    if(TAG(aptr) == R_ClassSymbol && TYPEOF(CAR(aptr)) == STRSXP) {
+      for(R_xlen_t i=0; i<Rf_xlength(CAR(aptr)); i++) {
+        if(std::strcmp(CHAR(STRING_ELT(CAR(aptr), i)), "data.frame") == 0) is_data_frame = true;
+      }
+    }
+  }
+  for(SEXP aptr = attributes; aptr != R_NilValue; aptr = CDR(aptr)) {
+    if(TAG(aptr) == R_NamesSymbol) {
+      SEXP names = CAR(aptr);
+      SEXP subset_names = PROTECT(Rf_allocVector(STRSXP, selected.size()));
+      for(uint64_t i=0; i<selected.size(); i++) {
+        SET_STRING_ELT(subset_names, i, STRING_ELT(names, selected[i]));
+      }
+      Rf_setAttrib(x, R_NamesSymbol, subset_names);
+      UNPROTECT(1);
+    } else if(is_data_frame) {
+      Rf_setAttrib(x, TAG(aptr), CAR(aptr));
+    }
+  }
+}
+
+// fallback for qread_elements when the file has no element index: subset a fully deserialized list
+inline SEXP subsetElements(SEXP const x, SEXP const elements) {
+  if(TYPEOF(x) != VECSXP) throw std::runtime_error("object is not a list");
+  std::vector<uint64_t> selected = selectElements(elements, Rf_xlength(x), ATTRIB(x));
+  SEXP ret = PROTECT(Rf_allocVector(VECSXP, selected.size()));
+  for(uint64_t i=0; i<selected.size(); i++) {
+    SET_VECTOR_ELT(ret, i, VECTOR_ELT(x, selected[i]));
+  }
+  setSubsetAttributes(ret, ATTRIB(x), selected);
+  UNPROTECT(1);
+  return ret;
+}
+
 
 // This function reads through the data but does not return the R object, only it's attributes
 //
@@ -746,20 +1185,45 @@ SEXP processAttributes(T * const sobj, const bool get_attr = true) {
     }
     break;
   case qstype::NUMERIC:
+    sobj->alignData(r_array_len*8);
     sobj->getBlockData(sobj->tempBlock(r_array_len*8), r_array_len*8);
     break;
   case qstype::INTEGER:
+    sobj->alignData(r_array_len*4);
     sobj->getBlockData(sobj->tempBlock(r_array_len*4), r_array_len*4);
     break;
   case qstype::LOGICAL:
+    sobj->alignData(r_array_len*4);
     sobj->getBlockData(sobj->tempBlock(r_array_len*4), r_array_len*4);
     break;
   case qstype::COMPLEX:
+    sobj->alignData(r_array_len*16);
     sobj->getBlockData(sobj->tempBlock(r_array_len*16), r_array_len*16);
     break;
   case qstype::RAW:
     sobj->getBlockData(sobj->tempBlock(r_array_len), r_array_len);
     break;
+  case qstype::CHARACTER_DICT:
+  {
+    uint8_t nbits;
+    uint32_t dict_size;
+    sobj->getBlockData(reinterpret_cast<char*>(&nbits), 1);
+    sobj->getBlockData(reinterpret_cast<char*>(&dict_size), 4);
+    std::string temp_string;
+    for(uint32_t j=0; j<dict_size; j++) {
+      readString(sobj, temp_string); // added to the string table for attribute values read later
+    }
+    uint64_t code_bytes = (r_array_len * nbits + 7) / 8;
+    sobj->getBlockData(sobj->tempBlock(code_bytes), code_bytes);
+  }
+    break;
+  case qstype::CHARACTER_COLUMNAR:
+    if(sobj->qm.string_dedup) {
+      readCharacterColumnar(sobj, r_array_len); // attribute values read later can refer back to the strings
+    } else {
+      sobj->columnar.read(sobj, r_array_len);
+    }
+    break;
   case qstype::CHARACTER:
   {
     std::string temp_string;
@@ -767,10 +1231,16 @@ SEXP processAttributes(T * const sobj, const bool get_attr = true) {
       uint32_t r_string_len;
       cetype_t string_encoding;
       sobj->readStringHeader(r_string_len, string_encoding);
-      if(r_string_len != NA_STRING_LENGTH) {
+      if(r_string_len != NA_STRING_LENGTH && !isStringRef(r_string_len)) {
         if(r_string_len != 0) {
           if(r_string_len > temp_string.size()) temp_string.resize(r_string_len);
           sobj->getBlockData(&temp_string[0], r_string_len);
+          // attribute values read later can refer back to the string
+          if(sobj->qm.string_dedup) {
+            SEXP xi = PROTECT(Rf_mkCharLenCE(temp_string.c_str(), r_string_len, string_encoding));
+            sobj->string_table.add(xi);
+            UNPROTECT(1);
+          }
         }
       }
     }
@@ -826,4 +1296,136 @@ SEXP processAttributes(T * const sobj, const bool get_attr = true) {
   return R_NilValue;
 }
 
+// This function reads through an object without creating it, used by qinspect
+// Like processAttributes, it follows processBlock and needs to be kept in sync with it manually
+// The headers are counted by the context in readHeader, vector and string data is passed over with skipData
+template <class T>
+inline void inspectString(T * const sobj) {
+  uint32_t r_string_len;
+  cetype_t string_encoding;
+  sobj->readStringHeader(r_string_len, string_encoding);
+  if(r_string_len != NA_STRING_LENGTH && !isStringRef(r_string_len)) sobj->skipData(r_string_len);
+}
+
+// same explicit stack as processBlock, without the objects
+struct InspectFrame {
+  qstype obj_type;
+  uint64_t children;
+  uint64_t number_of_attributes;
+  uint64_t next;
+};
+
+template <class T>
+void inspectObjectStep(T * const sobj, std::vector<InspectFrame> & frames) {
+  qstype obj_type;
+  uint64_t r_array_len;
+  uint64_t number_of_attributes = 0;
+  uint64_t children = 0;
+  sobj->readHeader(obj_type, r_array_len);
+  if(obj_type == qstype::S4FLAG) {
+    sobj->readHeader(obj_type, r_array_len);
+  }
+  if(obj_type == qstype::ATTRIBUTE) {
+    number_of_attributes = r_array_len;
+    sobj->readHeader(obj_type, r_array_len);
+  }
+  switch(obj_type) {
+  case qstype::PAIRLIST:
+  case qstype::PAIRLIST_WF:
+  case qstype::LIST:
+    children = r_array_len;
+    break;
+  case qstype::LANG:
+  case qstype::CLOS:
+  case qstype::PROM:
+  case qstype::DOT:
+  case qstype::LANG_WF:
+  case qstype::CLOS_WF:
+  case qstype::PROM_WF:
+  case qstype::DOT_WF:
+  case qstype::UNLOCKED_ENV:
+  case qstype::LOCKED_ENV:
+    children = 3; // TAG, CAR, CDR or ENCLOS, FRAME, HASHTAB
+    break;
+  case qstype::S4:
+    break;
+  case qstype::NUMERIC:
+    sobj->alignData(r_array_len*8);
+    sobj->skipData(r_array_len*8);
+    break;
+  case qstype::INTEGER:
+  case qstype::LOGICAL:
+    sobj->alignData(r_array_len*4);
+    sobj->skipData(r_array_len*4);
+    break;
+  case qstype::COMPLEX:
+    sobj->alignData(r_array_len*16);
+    sobj->skipData(r_array_len*16);
+    break;
+  case qstype::RAW:
+    sobj->skipData(r_array_len);
+    break;
+  case qstype::CHARACTER:
+    for(uint64_t i=0; i<r_array_len; i++) {
+      inspectString(sobj);
+    }
+    break;
+  case qstype::CHARACTER_DICT:
+  {
+    uint8_t nbits;
+    uint32_t dict_size;
+    sobj->getBlockData(reinterpret_cast<char*>(&nbits), 1);
+    sobj->getBlockData(reinterpret_cast<char*>(&dict_size), 4);
+    for(uint32_t j=0; j<dict_size; j++) {
+      inspectString(sobj);
+    }
+    sobj->skipData((r_array_len * nbits + 7) / 8);
+  }
+    break;
+  case qstype::CHARACTER_COLUMNAR:
+  {
+    uint8_t common_encoding;
+    uint64_t blob_size;
+    sobj->getBlockData(reinterpret_cast<char*>(&common_encoding), 1);
+    sobj->skipData(r_array_len*4);
+    if(common_encoding == COLUMNAR_MIXED_ENCODINGS) sobj->skipData(r_array_len);
+    sobj->getBlockData(reinterpret_cast<char*>(&blob_size), 8);
+    sobj->skipData(blob_size);
+  }
+    break;
+  case qstype::SYM:
+    inspectString(sobj);
+    break;
+  case qstype::RSERIALIZED:
+    sobj->skipData(r_array_len); // attributes are within the R-serialized object
+    return;
+  default: // also NILSXP and REFERENCE
+    return;
+  }
+  if(children + number_of_attributes > 0) frames.push_back(InspectFrame{obj_type, children, number_of_attributes, 0});
+}
+
+template <class T>
+void inspectObject(T * const sobj) {
+  std::vector<InspectFrame> frames;
+  inspectObjectStep(sobj, frames);
+  while(!frames.empty()) {
+    InspectFrame & f = frames.back();
+    if(f.next < f.children) {
+      if(f.obj_type == qstype::PAIRLIST_WF) {
+        int packed_flags;
+        sobj->readFlags(packed_flags);
+      }
+      if(f.obj_type == qstype::PAIRLIST || f.obj_type == qstype::PAIRLIST_WF) inspectString(sobj); // TAG
+    } else if(f.next < f.children + f.number_of_attributes) {
+      inspectString(sobj); // attribute name
+    } else {
+      frames.pop_back();
+      continue;
+    }
+    f.next++;
+    inspectObjectStep(sobj, frames);
+  }
+}
+
 #endif
@@ -26,6 +26,7 @@
 #include "qs_mt_deserialization.h"
 #include "qs_serialization_stream.h"
 #include "qs_deserialization_stream.h"
+#include "qs_altrep.h"
 #include "extra_functions.h"
 
 #define FILE_SAVE_ERR_MSG "Failed to open for writing. Does the directory exist? Do you have file permissions? Is the file name long? (>255 chars)"
@@ -39,6 +40,7 @@
  * qs_common.h -> qs_deserialize_common.h -> qs_mt_deserialization.h -> qs_functions.cpp
  * qs_common.h -> qs_serialize_common.h -> qs_serialization_stream.h -> qs_functions.cpp
  * qs_common.h -> qs_deserialize_common.h -> qs_deserialization_stream.h -> qs_functions.cpp
+ * qs_common.h -> qs_deserialize_common.h -> qs_deserialization.h -> qs_altrep.h -> qs_functions.cpp
  */
 
 // [[Rcpp::interfaces(r, cpp)]]
@@ -55,20 +57,22 @@ bool is_big_endian() {
 
 // [[Rcpp::export(rng = false, invisible=true)]]
 double qsave(SEXP const x, const std::string & file, const std::string preset="high", const std::string algorithm="zstd",
-               const int compress_level=4L, const int shuffle_control=15L, const bool check_hash=true, const int nthreads=1) {
+               const int compress_level=4L, const int shuffle_control=15L, const bool check_hash=true, const int nthreads=1,
+               const int block_size=524288, const bool block_hash=false, const bool string_dedup=false,
+               const bool block_index=false, const bool raw_blocks=false, const bool string_dict=false, const bool string_columnar=false) {
   std::ofstream myFile(R_ExpandFileName(file.c_str()), std::ios::out | std::ios::binary);
   if(!myFile) {
     throw std::runtime_error("For file " + file + ": " + FILE_SAVE_ERR_MSG);
   }
   myFile.exceptions(std::ofstream::failbit | std::ofstream::badbit);
   std::streampos origin = myFile.tellp();
-  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash);
+  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash, static_cast<uint64_t>(block_size), block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar);
   qm.writeToFile(myFile);
   std::streampos header_end_pos = myFile.tellp();
   writeSize8(myFile, 0); // number of compressed blocks
   uint64_t clength;
   if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd_stream)) {
-    ZSTD_streamWrite<std::ofstream> sw(myFile, qm);
+    ZSTD_streamWrite<std::ofstream> sw(myFile, qm, nthreads);
     CompressBufferStream<ZSTD_streamWrite<std::ofstream>> vbuf(sw, qm);
     writeObject(&vbuf, x);
     sw.flush();
@@ -84,49 +88,61 @@ double qsave(SEXP const x, const std::string & file, const std::string preset="h
     if(nthreads <= 1) {
       if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
         CompressBuffer<std::ofstream, zstd_compress_env> vbuf(myFile, qm);
-        writeObject(&vbuf, x);
+        writeObjectIndexed(&vbuf, x);
         vbuf.flush();
         // std::cout << vbuf.xenv.digest() << std::endl;
         if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+        if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+        if(qm.block_index) vbuf.block_index.writeToFile(myFile);
         clength = vbuf.number_of_blocks;
       } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
         CompressBuffer<std::ofstream, lz4_compress_env> vbuf(myFile, qm);
-        writeObject(&vbuf, x);
+        writeObjectIndexed(&vbuf, x);
         vbuf.flush();
         // std::cout << vbuf.xenv.digest() << std::endl;
         if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+        if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+        if(qm.block_index) vbuf.block_index.writeToFile(myFile);
         clength = vbuf.number_of_blocks;
       } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
         CompressBuffer<std::ofstream, lz4hc_compress_env> vbuf(myFile, qm);
-        writeObject(&vbuf, x);
+        writeObjectIndexed(&vbuf, x);
         vbuf.flush();
         // std::cout << vbuf.xenv.digest() << std::endl;
         if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+        if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+        if(qm.block_index) vbuf.block_index.writeToFile(myFile);
         clength = vbuf.number_of_blocks;
       } else {
         throw std::runtime_error("invalid compression algorithm selected");
       }
     } else {
       if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
-        CompressBuffer_MT<zstd_compress_env> vbuf(&myFile, qm, nthreads);
-        writeObject(&vbuf, x);
+        CompressBuffer_MT<std::ofstream, zstd_compress_env> vbuf(&myFile, qm, nthreads);
+        writeObjectIndexed(&vbuf, x);
         vbuf.flush();
         vbuf.ctc.finish();
         if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+        if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+        if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
         clength = vbuf.number_of_blocks;
       } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
-        CompressBuffer_MT<lz4_compress_env> vbuf(&myFile, qm, nthreads);
-        writeObject(&vbuf, x);
+        CompressBuffer_MT<std::ofstream, lz4_compress_env> vbuf(&myFile, qm, nthreads);
+        writeObjectIndexed(&vbuf, x);
         vbuf.flush();
         vbuf.ctc.finish();
         if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+        if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+        if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
         clength = vbuf.number_of_blocks;
       } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
-        CompressBuffer_MT<lz4hc_compress_env> vbuf(&myFile, qm, nthreads);
-        writeObject(&vbuf, x);
+        CompressBuffer_MT<std::ofstream, lz4hc_compress_env> vbuf(&myFile, qm, nthreads);
+        writeObjectIndexed(&vbuf, x);
         vbuf.flush();
         vbuf.ctc.finish();
         if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+        if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+        if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
         clength = vbuf.number_of_blocks;
       } else {
         throw std::runtime_error("invalid compression algorithm selected");
@@ -149,13 +165,17 @@ double c_qsave(SEXP const x, const std::string & file, const std::string preset,
 
 // [[Rcpp::export(rng = false, invisible=true)]]
 double qsave_fd(SEXP const x, const int fd, const std::string preset="high", const std::string algorithm="zstd",
-                  const int compress_level=4L, const int shuffle_control=15, const bool check_hash=true) {
+                  const int compress_level=4L, const int shuffle_control=15, const bool check_hash=true, const int nthreads=1,
+                  const int block_size=524288, const bool block_hash=false, const bool string_dedup=false,
+                  const bool block_index=false, const bool raw_blocks=false, const bool string_dict=false, const bool string_columnar=false) {
   fd_wrapper myFile(fd);
-  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash);
+  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash, static_cast<uint64_t>(block_size), block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar);
+  // the number of blocks can't be written to the header afterwards, the multithreaded reader needs the end of the data marked instead
+  qm.block_sentinel = nthreads > 1 && qm.blockAlgorithm();
   qm.writeToFile(myFile);
   writeSize8(myFile, 0); // number of compressed blocks
   if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd_stream)) {
-    ZSTD_streamWrite<fd_wrapper> sw(myFile, qm);
+    ZSTD_streamWrite<fd_wrapper> sw(myFile, qm, nthreads);
     CompressBufferStream<ZSTD_streamWrite<fd_wrapper>> vbuf(sw, qm);
     writeObject(&vbuf, x);
     sw.flush();
@@ -165,23 +185,62 @@ double qsave_fd(SEXP const x, const int fd, const std::string preset="high", con
     CompressBufferStream<uncompressed_streamWrite<fd_wrapper>> vbuf(sw, qm);
     writeObject(&vbuf, x);
     if(qm.check_hash) writeSize4(myFile, vbuf.sobj.xenv.digest());
-  } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
-    CompressBuffer<fd_wrapper, zstd_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
-    vbuf.flush();
-    if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
-  } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
-    CompressBuffer<fd_wrapper, lz4_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
-    vbuf.flush();
-    if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
-  } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
-    CompressBuffer<fd_wrapper, lz4hc_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
-    vbuf.flush();
-    if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+  } else if(nthreads <= 1) {
+    if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
+      CompressBuffer<fd_wrapper, zstd_compress_env> vbuf(myFile, qm);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.block_index.writeToFile(myFile);
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
+      CompressBuffer<fd_wrapper, lz4_compress_env> vbuf(myFile, qm);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.block_index.writeToFile(myFile);
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
+      CompressBuffer<fd_wrapper, lz4hc_compress_env> vbuf(myFile, qm);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.block_index.writeToFile(myFile);
+    } else {
+      throw std::runtime_error("invalid compression algorithm selected");
+    }
   } else {
-    throw std::runtime_error("invalid compression algorithm selected");
+    if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
+      CompressBuffer_MT<fd_wrapper, zstd_compress_env> vbuf(&myFile, qm, nthreads);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      vbuf.ctc.finish();
+      writeSize4(myFile, 0); // end of block data
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
+      CompressBuffer_MT<fd_wrapper, lz4_compress_env> vbuf(&myFile, qm, nthreads);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      vbuf.ctc.finish();
+      writeSize4(myFile, 0); // end of block data
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
+      CompressBuffer_MT<fd_wrapper, lz4hc_compress_env> vbuf(&myFile, qm, nthreads);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      vbuf.ctc.finish();
+      writeSize4(myFile, 0); // end of block data
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
+    } else {
+      throw std::runtime_error("invalid compression algorithm selected");
+    }
   }
   myFile.flush();
   return static_cast<double>(myFile.bytes_processed);
@@ -189,11 +248,13 @@ double qsave_fd(SEXP const x, const int fd, const std::string preset="high", con
 
 // [[Rcpp::export(rng = false, invisible=true)]]
 double qsave_handle(SEXP const x, SEXP const handle, const std::string preset="high",
-                    const std::string algorithm="zstd", const int compress_level=4L, const int shuffle_control=15, const bool check_hash=true) {
+                    const std::string algorithm="zstd", const int compress_level=4L, const int shuffle_control=15, const bool check_hash=true,
+                    const int block_size=524288, const bool block_hash=false, const bool string_dedup=false,
+                    const bool block_index=false, const bool raw_blocks=false, const bool string_dict=false, const bool string_columnar=false) {
 #ifdef _WIN32
   HANDLE h = R_ExternalPtrAddr(handle);
   handle_wrapper myFile(h);
-  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash);
+  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash, static_cast<uint64_t>(block_size), block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar);
   qm.writeToFile(myFile);
   writeSize8(myFile, 0); // number of compressed blocks
   if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd_stream)) {
@@ -209,19 +270,25 @@ double qsave_handle(SEXP const x, SEXP const handle, const std::string preset="h
     if(qm.check_hash) writeSize4(myFile, vbuf.sobj.xenv.digest());
   } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
     CompressBuffer<handle_wrapper, zstd_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
+    writeObjectIndexed(&vbuf, x);
     vbuf.flush();
     if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+    if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+    if(qm.block_index) vbuf.block_index.writeToFile(myFile);
   } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
     CompressBuffer<handle_wrapper, lz4_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
+    writeObjectIndexed(&vbuf, x);
     vbuf.flush();
     if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+    if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+    if(qm.block_index) vbuf.block_index.writeToFile(myFile);
   } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
     CompressBuffer<handle_wrapper, lz4hc_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
+    writeObjectIndexed(&vbuf, x);
     vbuf.flush();
     if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+    if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+    if(qm.block_index) vbuf.block_index.writeToFile(myFile);
   } else {
     throw std::runtime_error("invalid compression algorithm selected");
   }
@@ -233,15 +300,23 @@ double qsave_handle(SEXP const x, SEXP const handle, const std::string preset="h
 
 // [[Rcpp::export(rng = false)]]
 RawVector qserialize(SEXP const x, const std::string preset="high", const std::string algorithm="zstd",
-                     const int compress_level=4L, const int shuffle_control=15, const bool check_hash=true) {
+                     const int compress_level=4L, const int shuffle_control=15, const bool check_hash=true, const int nthreads=1,
+                     const int block_size=524288, SEXP const dictionary=R_NilValue, const bool block_hash=false, const bool string_dedup=false,
+                     const bool block_index=false, const bool raw_blocks=false, const bool string_dict=false, const bool string_columnar=false) {
   vec_wrapper myFile;
-  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash);
+  QsMetadata qm(preset, algorithm, compress_level, shuffle_control, check_hash, static_cast<uint64_t>(block_size), block_hash, string_dedup, block_index, raw_blocks, string_dict, string_columnar);
+  if(dictionary != R_NilValue) {
+    if(qm.compress_algorithm != static_cast<unsigned char>(compalg::zstd)) throw std::runtime_error("a dictionary can only be used with the zstd algorithm");
+    if(TYPEOF(dictionary) != RAWSXP) throw std::runtime_error("dictionary must be a raw vector, see zstd_train_dictionary");
+    qm.dict_id = zstd_dictionaries().add(reinterpret_cast<char*>(RAW(dictionary)), Rf_xlength(dictionary));
+    qm.dictionary = true;
+  }
   qm.writeToFile(myFile);
   uint64_t filesize_offset = myFile.bytes_processed;
   writeSize8(myFile, 0); // number of compressed blocks
   uint64_t clength;
   if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd_stream)) {
-    ZSTD_streamWrite<vec_wrapper> sw(myFile, qm);
+    ZSTD_streamWrite<vec_wrapper> sw(myFile, qm, nthreads);
     CompressBufferStream<ZSTD_streamWrite<vec_wrapper>> vbuf(sw, qm);
     writeObject(&vbuf, x);
     sw.flush();
@@ -253,26 +328,65 @@ RawVector qserialize(SEXP const x, const std::string preset="high", const std::s
     writeObject(&vbuf, x);
     if(qm.check_hash) writeSize4(myFile, vbuf.sobj.xenv.digest());
     clength = sw.bytes_written;
-  } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
-    CompressBuffer<vec_wrapper, zstd_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
-    vbuf.flush();
-    if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
-    clength = vbuf.number_of_blocks;
-  } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
-    CompressBuffer<vec_wrapper, lz4_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
-    vbuf.flush();
-    if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
-    clength = vbuf.number_of_blocks;
-  } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
-    CompressBuffer<vec_wrapper, lz4hc_compress_env> vbuf(myFile, qm);
-    writeObject(&vbuf, x);
-    vbuf.flush();
-    if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
-    clength = vbuf.number_of_blocks;
+  } else if(nthreads <= 1) {
+    if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
+      CompressBuffer<vec_wrapper, zstd_compress_env> vbuf(myFile, qm);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.block_index.writeToFile(myFile);
+      clength = vbuf.number_of_blocks;
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
+      CompressBuffer<vec_wrapper, lz4_compress_env> vbuf(myFile, qm);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.block_index.writeToFile(myFile);
+      clength = vbuf.number_of_blocks;
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
+      CompressBuffer<vec_wrapper, lz4hc_compress_env> vbuf(myFile, qm);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.block_index.writeToFile(myFile);
+      clength = vbuf.number_of_blocks;
+    } else {
+      throw std::runtime_error("invalid compression algorithm selected");
+    }
   } else {
-    throw std::runtime_error("invalid compression algorithm selected");
+    if(qm.compress_algorithm == static_cast<unsigned char>(compalg::zstd)) {
+      CompressBuffer_MT<vec_wrapper, zstd_compress_env> vbuf(&myFile, qm, nthreads);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      vbuf.ctc.finish();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
+      clength = vbuf.number_of_blocks;
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4)) {
+      CompressBuffer_MT<vec_wrapper, lz4_compress_env> vbuf(&myFile, qm, nthreads);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      vbuf.ctc.finish();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
+      clength = vbuf.number_of_blocks;
+    } else if(qm.compress_algorithm == static_cast<unsigned char>(compalg::lz4hc)) {
+      CompressBuffer_MT<vec_wrapper, lz4hc_compress_env> vbuf(&myFile, qm, nthreads);
+      writeObjectIndexed(&vbuf, x);
+      vbuf.flush();
+      vbuf.ctc.finish();
+      if(qm.check_hash) writeSize4(myFile, vbuf.xenv.digest());
+      if(qm.element_index) vbuf.element_index.writeToFile(myFile);
+      if(qm.block_index) vbuf.ctc.block_index.writeToFile(myFile);
+      clength = vbuf.number_of_blocks;
+    } else {
+      throw std::runtime_error("invalid compression algorithm selected");
+    }
   }
   myFile.writeDirect(reinterpret_cast<char*>(&clength), 8, filesize_offset);
   myFile.shrink();
@@ -285,8 +399,25 @@ RawVector c_qserialize(SEXP const x, const std::string preset, const std::string
   return qserialize(x, preset, algorithm, compress_level, shuffle_control, check_hash);
 }
 
+// the hash of the whole object, computed by decompressing every block again on nthreads threads
+// used by lazy reads, which skip the data of lazy vectors
+template <class decompress_env>
+uint32_t rehash_blocks(std::ifstream & myFile, const QsMetadata & qm, const BlockIndex & bi, const int nthreads) {
+  Verify_Thread_Context<decompress_env> vtc(myFile, qm, bi, nthreads > 1 ? nthreads : 1);
+  vtc.run();
+  if(!vtc.corrupt_blocks.empty()) {
+    std::sort(vtc.corrupt_blocks.begin(), vtc.corrupt_blocks.end());
+    throw std::runtime_error("Error in block " + std::to_string(vtc.corrupt_blocks[0].first) + ": " + vtc.corrupt_blocks[0].second);
+  }
+  return vtc.xenv.digest();
+}
+
+SEXP qread_elements(const std::string & file, SEXP const elements, const bool use_alt_rep, const bool lazy, const bool strict, const int nthreads);
+
 // [[Rcpp::export(rng = false)]]
-SEXP qread(const std::string & file, const bool use_alt_rep=false, const bool strict=false, const int nthreads=1) {
+SEXP qread(const std::string & file, const bool use_alt_rep=false, const bool strict=false, const int nthreads=1,
+           SEXP const columns=R_NilValue, const bool lazy=false) {
+  if(columns != R_NilValue) return qread_elements(file, columns, use_alt_rep, lazy, strict, nthreads);
   std::ifstream myFile(R_ExpandFileName(file.c_str()), std::ios::in | std::ios::binary);
   if(!myFile) {
     throw std::runtime_error("For file " + file + ": " + FILE_READ_ERR_MSG);
@@ -294,7 +425,15 @@ SEXP qread(const std::string & file, const bool use_alt_rep=false, const bool st
   myFile.exceptions(std::ifstream::badbit); // do not check failbit, it is set when eof is checked in validate_data
   Protect_Tracker pt = Protect_Tracker();
   QsMetadata qm = QsMetadata::create(myFile);
-  if(qm.compress_algorithm == 3) { // zstd_stream
+  if(qm.compress_algorithm == 3 && nthreads > 1) { // zstd_stream, decompressed ahead on a second thread
+    ZSTD_streamRead_MT<std::ifstream> sr(myFile, qm);
+    Data_Context_Stream<ZSTD_streamRead_MT<std::ifstream>> dc(sr, qm, use_alt_rep);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    sr.finish();
+    validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict, file);
+    myFile.close();
+    return ret;
+  } else if(qm.compress_algorithm == 3) { // zstd_stream
     ZSTD_streamRead<std::ifstream> sr(myFile, qm);
     Data_Context_Stream<ZSTD_streamRead<std::ifstream>> dc(sr, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
@@ -308,17 +447,56 @@ SEXP qread(const std::string & file, const bool use_alt_rep=false, const bool st
     validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict, file);
     myFile.close();
     return ret;
+  } else if(lazy && qm.block_index) {
+    std::streampos current = myFile.tellg();
+    std::shared_ptr<LazyFile> lazy_file = std::make_shared<LazyFile>(full_path(file), qm, BlockIndex());
+    lazy_file->bi.readFromEnd(myFile);
+    myFile.seekg(current);
+    SEXP ret;
+    uint64_t blocks_read;
+    if(qm.compress_algorithm == 0) {
+      Data_Context<std::ifstream, zstd_decompress_env> dc(myFile, qm, use_alt_rep);
+      dc.lazy_file = lazy_file;
+      ret = PROTECT(processBlock(&dc)); pt++;
+      dc.finish();
+      blocks_read = dc.blocks_read;
+    } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
+      Data_Context<std::ifstream, lz4_decompress_env> dc(myFile, qm, use_alt_rep);
+      dc.lazy_file = lazy_file;
+      ret = PROTECT(processBlock(&dc)); pt++;
+      dc.finish();
+      blocks_read = dc.blocks_read;
+    } else {
+      throw std::runtime_error("Invalid compression algorithm in file");
+    }
+    // the data of lazy vectors is skipped, so the running hash is incomplete
+    // with strict, the hash is computed by decompressing all blocks again; otherwise it is only checked that the file is intact
+    uint32_t recorded_hash = qm.check_hash ? readSize4(myFile) : 0;
+    uint32_t computed_hash = recorded_hash;
+    if(strict && qm.check_hash) {
+      // rehash_blocks seeks to every block, validate_data continues after the hash
+      std::streampos after_hash = myFile.tellg();
+      computed_hash = qm.compress_algorithm == 0 ? rehash_blocks<zstd_decompress_env>(myFile, qm, lazy_file->bi, nthreads) :
+                                                   rehash_blocks<lz4_decompress_env>(myFile, qm, lazy_file->bi, nthreads);
+      myFile.clear();
+      myFile.seekg(after_hash);
+    }
+    validate_data(qm, myFile, recorded_hash, computed_hash, blocks_read, strict, file);
+    myFile.close();
+    return ret;
   } else {
-    if(nthreads <= 1 || qm.clength == 0) {
+    if(nthreads <= 1 || (qm.clength == 0 && !qm.block_sentinel)) {
       if(qm.compress_algorithm == 0) {
         Data_Context<std::ifstream, zstd_decompress_env> dc(myFile, qm, use_alt_rep);
         SEXP ret = PROTECT(processBlock(&dc)); pt++;
+        dc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict, file);
         myFile.close();
         return ret;
       } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
         Data_Context<std::ifstream, lz4_decompress_env> dc(myFile, qm, use_alt_rep);
         SEXP ret = PROTECT(processBlock(&dc)); pt++;
+        dc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict, file);
         myFile.close();
         return ret;
@@ -327,14 +505,14 @@ SEXP qread(const std::string & file, const bool use_alt_rep=false, const bool st
       }
     } else {
       if(qm.compress_algorithm == 0) {
-        Data_Context_MT<zstd_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+        Data_Context_MT<std::ifstream, zstd_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
         SEXP ret = PROTECT(processBlock(&dc)); pt++;
         dc.dtc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict, file);
         myFile.close();
         return ret;
       } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
-        Data_Context_MT<lz4_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+        Data_Context_MT<std::ifstream, lz4_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
         SEXP ret = PROTECT(processBlock(&dc)); pt++;
         dc.dtc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict, file);
@@ -347,6 +525,40 @@ SEXP qread(const std::string & file, const bool use_alt_rep=false, const bool st
   }
 }
 
+// [[Rcpp::export(rng = false)]]
+SEXP qread_elements(const std::string & file, SEXP const elements, const bool use_alt_rep=false, const bool lazy=false,
+                    const bool strict=false, const int nthreads=1) {
+  std::ifstream myFile(R_ExpandFileName(file.c_str()), std::ios::in | std::ios::binary);
+  if(!myFile) {
+    throw std::runtime_error("For file " + file + ": " + FILE_READ_ERR_MSG);
+  }
+  myFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  QsMetadata qm = QsMetadata::create(myFile);
+  BlockIndex bi;
+  ElementIndex ei;
+  if(qm.element_index && qm.block_index) {
+    bi.readFromEnd(myFile);
+    ei.readFromEnd(myFile, bi);
+  }
+  // no usable element index (older format, stream algorithm or not a plain list), read everything
+  // the hash of the whole object can only be verified by reading everything, block hashes are verified for each block that is read
+  if(ei.size() == 0 || (strict && qm.check_hash && !qm.block_hash)) {
+    myFile.close();
+    Protect_Tracker pt = Protect_Tracker();
+    SEXP x = PROTECT(qread(file, use_alt_rep, strict, nthreads, R_NilValue, lazy)); pt++;
+    return subsetElements(x, elements);
+  }
+  std::shared_ptr<const LazyFile> lazy_file;
+  if(lazy) lazy_file = std::make_shared<LazyFile>(full_path(file), qm, bi);
+  if(qm.compress_algorithm == 0) {
+    return readElements<zstd_decompress_env>(myFile, qm, bi, ei, elements, use_alt_rep, lazy_file);
+  } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
+    return readElements<lz4_decompress_env>(myFile, qm, bi, ei, elements, use_alt_rep, lazy_file);
+  } else {
+    throw std::runtime_error("Invalid compression algorithm in file");
+  }
+}
+
 // [[Rcpp::export(rng = false)]]
 SEXP c_qattributes(const std::string & file, const bool use_alt_rep=false, const bool strict=false, const int nthreads=1) {
   std::ifstream myFile(R_ExpandFileName(file.c_str()), std::ios::in | std::ios::binary);
@@ -356,7 +568,15 @@ SEXP c_qattributes(const std::string & file, const bool use_alt_rep=false, const
   myFile.exceptions(std::ifstream::badbit); // do not check failbit, it is set when eof is checked in validate_data
   Protect_Tracker pt = Protect_Tracker();
   QsMetadata qm = QsMetadata::create(myFile);
-  if(qm.compress_algorithm == 3) { // zstd_stream
+  if(qm.compress_algorithm == 3 && nthreads > 1) { // zstd_stream, decompressed ahead on a second thread
+    ZSTD_streamRead_MT<std::ifstream> sr(myFile, qm);
+    Data_Context_Stream<ZSTD_streamRead_MT<std::ifstream>> dc(sr, qm, use_alt_rep);
+    SEXP ret = PROTECT(processAttributes(&dc)); pt++;
+    sr.finish();
+    validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict, file);
+    myFile.close();
+    return ret;
+  } else if(qm.compress_algorithm == 3) { // zstd_stream
     ZSTD_streamRead<std::ifstream> sr(myFile, qm);
     Data_Context_Stream<ZSTD_streamRead<std::ifstream>> dc(sr, qm, use_alt_rep);
     SEXP ret = PROTECT(processAttributes(&dc)); pt++;
@@ -371,16 +591,18 @@ SEXP c_qattributes(const std::string & file, const bool use_alt_rep=false, const
     myFile.close();
     return ret;
   } else {
-    if(nthreads <= 1 || qm.clength == 0) {
+    if(nthreads <= 1 || (qm.clength == 0 && !qm.block_sentinel)) {
       if(qm.compress_algorithm == 0) {
         Data_Context<std::ifstream, zstd_decompress_env> dc(myFile, qm, use_alt_rep);
         SEXP ret = PROTECT(processAttributes(&dc)); pt++;
+        dc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict, file);
         myFile.close();
         return ret;
       } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
         Data_Context<std::ifstream, lz4_decompress_env> dc(myFile, qm, use_alt_rep);
         SEXP ret = PROTECT(processAttributes(&dc)); pt++;
+        dc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict, file);
         myFile.close();
         return ret;
@@ -389,14 +611,14 @@ SEXP c_qattributes(const std::string & file, const bool use_alt_rep=false, const
       }
     } else {
       if(qm.compress_algorithm == 0) {
-        Data_Context_MT<zstd_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+        Data_Context_MT<std::ifstream, zstd_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
         SEXP ret = PROTECT(processAttributes(&dc)); pt++;
         dc.dtc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict, file);
         myFile.close();
         return ret;
       } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
-        Data_Context_MT<lz4_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+        Data_Context_MT<std::ifstream, lz4_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
         SEXP ret = PROTECT(processAttributes(&dc)); pt++;
         dc.dtc.finish();
         validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict, file);
@@ -415,11 +637,18 @@ SEXP c_qread(const std::string & file, const bool use_alt_rep, const bool strict
 }
 
 // [[Rcpp::export(rng = false)]]
-SEXP qread_fd(const int fd, const bool use_alt_rep=false, const bool strict=false) {
+SEXP qread_fd(const int fd, const bool use_alt_rep=false, const bool strict=false, const int nthreads=1) {
   fd_wrapper myFile(fd);
   Protect_Tracker pt = Protect_Tracker();
   QsMetadata qm  = QsMetadata::create(myFile);
-  if(qm.compress_algorithm == 3) { // zstd_stream
+  if(qm.compress_algorithm == 3 && nthreads > 1) { // zstd_stream, decompressed ahead on a second thread
+    ZSTD_streamRead_MT<fd_wrapper> sr(myFile, qm);
+    Data_Context_Stream<ZSTD_streamRead_MT<fd_wrapper>> dc(sr, qm, use_alt_rep);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    sr.finish();
+    validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict);
+    return ret;
+  } else if(qm.compress_algorithm == 3) { // zstd_stream
     ZSTD_streamRead<fd_wrapper> sr(myFile, qm);
     Data_Context_Stream<ZSTD_streamRead<fd_wrapper>> dc(sr, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
@@ -431,14 +660,28 @@ SEXP qread_fd(const int fd, const bool use_alt_rep=false, const bool strict=fals
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
     validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict);
     return ret;
+  } else if(nthreads > 1 && qm.block_sentinel && qm.compress_algorithm == 0) {
+    Data_Context_MT<fd_wrapper, zstd_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.dtc.finish();
+    validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict);
+    return ret;
+  } else if(nthreads > 1 && qm.block_sentinel && (qm.compress_algorithm == 1 || qm.compress_algorithm == 2)) {
+    Data_Context_MT<fd_wrapper, lz4_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.dtc.finish();
+    validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict);
+    return ret;
   } else if(qm.compress_algorithm == 0) {
     Data_Context<fd_wrapper, zstd_decompress_env> dc(myFile, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.finish();
     validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict);
     return ret;
   } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
     Data_Context<fd_wrapper, lz4_decompress_env> dc(myFile, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.finish();
     validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict);
     return ret;
   } else {
@@ -468,11 +711,13 @@ SEXP qread_handle(SEXP const handle, const bool use_alt_rep=false, const bool st
   } else if(qm.compress_algorithm == 0) {
     Data_Context<handle_wrapper, zstd_decompress_env> dc(myFile, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.finish();
     validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict);
     return ret;
   } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
     Data_Context<handle_wrapper, lz4_decompress_env> dc(myFile, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.finish();
     validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict);
     return ret;
   } else {
@@ -484,12 +729,19 @@ SEXP qread_handle(SEXP const handle, const bool use_alt_rep=false, const bool st
 }
 
 // [[Rcpp::export(rng = false)]]
-SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep=false, const bool strict=false) {
+SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep=false, const bool strict=false, const int nthreads=1) {
   void * vp = R_ExternalPtrAddr(pointer);
   mem_wrapper myFile(vp, static_cast<uint64_t>(length));
   Protect_Tracker pt = Protect_Tracker();
   QsMetadata qm = QsMetadata::create(myFile);
-  if(qm.compress_algorithm == 3) { // zstd_stream
+  if(qm.compress_algorithm == 3 && nthreads > 1) { // zstd_stream, decompressed ahead on a second thread
+    ZSTD_streamRead_MT<mem_wrapper> sr(myFile, qm);
+    Data_Context_Stream<ZSTD_streamRead_MT<mem_wrapper>> dc(sr, qm, use_alt_rep);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    sr.finish();
+    validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict);
+    return ret;
+  } else if(qm.compress_algorithm == 3) { // zstd_stream
     ZSTD_streamRead<mem_wrapper> sr(myFile, qm);
     Data_Context_Stream<ZSTD_streamRead<mem_wrapper>> dc(sr, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
@@ -501,14 +753,28 @@ SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep=f
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
     validate_data(qm, myFile, *reinterpret_cast<uint32_t*>(dc.dsc.hash_reserve.data()), dc.dsc.xenv.digest(), dc.dsc.decompressed_bytes_read, strict);
     return ret;
+  } else if(nthreads > 1 && (qm.clength > 0 || qm.block_sentinel) && qm.compress_algorithm == 0) {
+    Data_Context_MT<mem_wrapper, zstd_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.dtc.finish();
+    validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict);
+    return ret;
+  } else if(nthreads > 1 && (qm.clength > 0 || qm.block_sentinel) && (qm.compress_algorithm == 1 || qm.compress_algorithm == 2)) {
+    Data_Context_MT<mem_wrapper, lz4_decompress_env> dc(myFile, qm, use_alt_rep, nthreads);
+    SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.dtc.finish();
+    validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), 0, strict);
+    return ret;
   } else if(qm.compress_algorithm == 0) {
     Data_Context<mem_wrapper, zstd_decompress_env> dc(myFile, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.finish();
     validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict);
     return ret;
   } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
     Data_Context<mem_wrapper, lz4_decompress_env> dc(myFile, qm, use_alt_rep);
     SEXP ret = PROTECT(processBlock(&dc)); pt++;
+    dc.finish();
     validate_data(qm, myFile, qm.check_hash ? readSize4(myFile) : 0, dc.xenv.digest(), dc.blocks_read, strict);
     return ret;
   } else {
@@ -517,12 +783,33 @@ SEXP qread_ptr(SEXP const pointer, const double length, const bool use_alt_rep=f
 }
 
 // [[Rcpp::export(rng = false)]]
-SEXP qdeserialize(SEXP const x, const bool use_alt_rep=false, const bool strict=false) {
+SEXP qread_mmap(const std::string & file, const bool use_alt_rep=false, const bool strict=false) {
+  std::shared_ptr<const MmapFile> mmap_file = std::make_shared<const MmapFile>(R_ExpandFileName(file.c_str()));
+  mem_wrapper myFile(mmap_file->map, mmap_file->length);
+  Protect_Tracker pt = Protect_Tracker();
+  QsMetadata qm = QsMetadata::create(myFile);
+  if(qm.compress_algorithm != 4) { // compressed files are decompressed from the map as with qread_ptr
+    SEXP pointer = PROTECT(R_MakeExternalPtr(mmap_file->map, R_NilValue, R_NilValue)); pt++;
+    return qread_ptr(pointer, static_cast<double>(mmap_file->length), use_alt_rep, strict);
+  }
+  Data_Context_Mmap dc(mmap_file, qm, use_alt_rep);
+  SEXP ret = PROTECT(processBlock(&dc)); pt++;
+  myFile.bytes_processed = QS_HEADER_LENGTH + dc.total_size;
+  uint32_t recorded_hash = qm.check_hash ? readSize4(myFile) : 0;
+  // data behind views is never read here, hashing it would load every page of the file
+  // so the hash is only computed if everything was copied, or if strict is set
+  uint32_t computed_hash = dc.views_created && !strict ? recorded_hash : XXH32(dc.data, dc.total_size, XXH_SEED);
+  validate_data(qm, myFile, recorded_hash, computed_hash, dc.data_offset, strict, file);
+  return ret;
+}
+
+// [[Rcpp::export(rng = false)]]
+SEXP qdeserialize(SEXP const x, const bool use_alt_rep=false, const bool strict=false, const int nthreads=1) {
   void * p = reinterpret_cast<void*>(RAW(x));
   double dlen = static_cast<double>(Rf_xlength(x));
   Protect_Tracker pt = Protect_Tracker();
   SEXP pointer = PROTECT(R_MakeExternalPtr(p, R_NilValue, R_NilValue)); pt++;
-  return qread_ptr(pointer, dlen, use_alt_rep, strict);
+  return qread_ptr(pointer, dlen, use_alt_rep, strict, nthreads);
 }
 
 // [[Rcpp::export(rng = false)]]
@@ -582,7 +869,7 @@ RObject qdump(const std::string & file) {
     RawVector input(readable_bytes);
     char* inp = reinterpret_cast<char*>(RAW(input));
     myFile.read(inp, readable_bytes);
-    auto zstream = zstd_decompress_stream_simple(totalsize, inp, readable_bytes);
+    auto zstream = zstd_decompress_stream_simple(totalsize, inp, readable_bytes, qm.window_log);
     bool is_error = zstream.decompress();
 
     // append results
@@ -621,7 +908,7 @@ RObject qdump(const std::string & file) {
     cbound_fun cbfun;
     iserror_fun errfun;
     if(qm.compress_algorithm == 0) {
-      dfun = ZSTD_decompress;
+      dfun = ZSTD_decompress_fun;
       cbfun = ZSTD_compressBound;
       errfun = ZSTD_isError;
     } else {
@@ -630,25 +917,60 @@ RObject qdump(const std::string & file) {
       errfun = LZ4_isError_fun;
     }
     if(qm.check_hash) readable_bytes -= 4;
-    std::vector<char> zblock(cbfun(BLOCKSIZE));
-    std::vector<char> block(BLOCKSIZE);
+    BlockIndex bi;
+    if(qm.block_index) {
+      bi.readFromEnd(myFile);
+      readable_bytes -= bi.footerSize();
+      myFile.seekg(current);
+    }
+    ElementIndex ei;
+    if(qm.element_index) {
+      ei.readFromEnd(myFile, bi);
+      readable_bytes -= ei.footerSize();
+      myFile.seekg(current);
+    }
+    std::vector<char> zblock(cbfun(qm.block_size));
+    std::vector<char> block(qm.block_size);
     List output = List(totalsize);
     List input = List(totalsize);
     IntegerVector block_sizes(totalsize);
     IntegerVector zblock_sizes(totalsize);
+    LogicalVector block_stored_raw(totalsize);
+    std::vector<std::string> recorded_block_hashes(qm.block_hash ? totalsize : 0);
+    LogicalVector block_hash_match(qm.block_hash ? totalsize : 0);
     xxhash_env xenv = xxhash_env();
     for(uint64_t i=0; i<totalsize; i++) {
       uint64_t zsize = readSize4(myFile);
       if(static_cast<uint64_t>(myFile.gcount()) != 4) break;
+      uint64_t recorded_block_hash = 0;
+      if(qm.block_hash) {
+        myFile.read(reinterpret_cast<char*>(&recorded_block_hash), 8);
+        if(static_cast<uint64_t>(myFile.gcount()) != 8) break;
+      }
+      bool raw = qm.raw_blocks && (zsize & RAW_BLOCK_BIT);
+      zsize = block_payload_size(zsize);
+      if(zsize > zblock.size()) break;
       myFile.read(zblock.data(), zsize);
       if(static_cast<uint64_t>(myFile.gcount()) != zsize) break;
-      uint64_t block_size = dfun(block.data(), BLOCKSIZE, zblock.data(), zsize);
+      uint64_t block_size;
+      if(raw) {
+        if(zsize > qm.block_size) break;
+        std::memcpy(block.data(), zblock.data(), zsize);
+        block_size = zsize;
+      } else {
+        block_size = dfun(block.data(), qm.block_size, zblock.data(), zsize);
+      }
       if(!errfun(block_size)) {
         xenv.update(block.data(), block_size);
         output[i] = RawVector(block.begin(), block.begin() + block_size);
         input[i] = RawVector(zblock.begin(), zblock.begin() + zsize);
         zblock_sizes[i] = zsize;
         block_sizes[i] = block_size;
+        block_stored_raw[i] = raw;
+        if(qm.block_hash) {
+          recorded_block_hashes[i] = std::to_string(recorded_block_hash);
+          block_hash_match[i] = blockHash(block.data(), block_size) == recorded_block_hash;
+        }
       }
     }
     // append results
@@ -656,11 +978,23 @@ RObject qdump(const std::string & file) {
     outvec["number_of_blocks"] = std::to_string(totalsize);
     outvec["compressed_block_sizes"] = zblock_sizes;
     outvec["decompressed_block_sizes"] = block_sizes;
+    outvec["block_stored_raw"] = block_stored_raw;
     outvec["computed_hash"] = std::to_string(xenv.digest());
     if(qm.check_hash) {
       uint32_t recorded_hash = readSize4(myFile);
       outvec["recorded_hash"] = std::to_string(recorded_hash);
     }
+    if(qm.block_hash) {
+      outvec["recorded_block_hashes"] = recorded_block_hashes;
+      outvec["block_hash_match"] = block_hash_match;
+    }
+    if(qm.block_index) {
+      outvec["block_file_offsets"] = std::vector<double>(bi.file_offsets.begin(), bi.file_offsets.end());
+      outvec["block_decompressed_offsets"] = std::vector<double>(bi.decompressed_offsets.begin(), bi.decompressed_offsets.end());
+    }
+    if(qm.element_index) {
+      outvec["element_offsets"] = std::vector<double>(ei.offsets.begin(), ei.offsets.end());
+    }
     outvec["compressed_data"] = input;
     outvec["uncompressed_data"] = output;
   } else {
@@ -670,6 +1004,262 @@ RObject qdump(const std::string & file) {
   return outvec;
 }
 
+// results of qverify, corrupt blocks count from 1
+struct VerifyResult {
+  uint64_t number_of_blocks = 0;
+  std::vector<double> corrupt_blocks;
+  std::vector<std::string> errors;
+  int hash_match = NA_LOGICAL; // NA if the file has no hash of the whole object or the hash could not be located
+};
+
+template <class decompress_env>
+void verify_blocks(std::ifstream & myFile, const QsMetadata & qm, const BlockIndex & bi, const int nthreads, uint64_t hash_offset,
+                   VerifyResult & result) {
+  Verify_Thread_Context<decompress_env> vtc(myFile, qm, bi, nthreads > 1 ? nthreads : 1);
+  vtc.run();
+  std::sort(vtc.corrupt_blocks.begin(), vtc.corrupt_blocks.end());
+  for(auto & cb : vtc.corrupt_blocks) {
+    result.corrupt_blocks.push_back(static_cast<double>(cb.first));
+    result.errors.push_back(cb.second);
+  }
+  result.number_of_blocks = vtc.blocks_total;
+  if(qm.check_hash) {
+    // without the block index the hash follows the last block, if the blocks could be read to the end
+    if(!qm.block_index) {
+      if(!vtc.end_of_data) return;
+      hash_offset = static_cast<uint64_t>(myFile.tellg());
+    }
+    myFile.clear();
+    myFile.seekg(hash_offset);
+    result.hash_match = readSize4(myFile) == vtc.xenv.digest();
+  }
+}
+
+// reads, decompresses and hashes the data without deserializing it
+// block compressed files are checked block by block on nthreads threads, so that corrupt blocks are reported individually
+// [[Rcpp::export(rng = false)]]
+List qverify(const std::string & file, const int nthreads=1) {
+  std::ifstream myFile(R_ExpandFileName(file.c_str()), std::ios::in | std::ios::binary);
+  if(!myFile) {
+    throw std::runtime_error("For file " + file + ": " + FILE_READ_ERR_MSG);
+  }
+  QsMetadata qm = QsMetadata::create(myFile);
+  VerifyResult result;
+  std::string error; // an error that is not located in a block, e.g. in a zstd_stream file
+  try {
+    if(qm.compress_algorithm == 3 || qm.compress_algorithm == 4) { // zstd_stream or uncompressed, a single stream that is read in order
+      uint64_t decompressed_bytes_read;
+      if(qm.compress_algorithm == 3) {
+        ZSTD_streamRead<std::ifstream> sr(myFile, qm);
+        while(!sr.end_of_decompression) {
+          sr.blockoffset = sr.blocksize; // discard the decompressed data
+          sr.getBlock();
+        }
+        decompressed_bytes_read = sr.decompressed_bytes_read;
+        if(qm.check_hash) result.hash_match = unaligned_cast<uint32_t>(sr.hash_reserve.data(), 0) == sr.xenv.digest();
+      } else {
+        uncompressed_streamRead<std::ifstream> sr(myFile, qm);
+        std::vector<char> block(BLOCKSIZE);
+        while(sr.read_update(block.data(), block.size()) > 0) {}
+        decompressed_bytes_read = sr.decompressed_bytes_read;
+        if(qm.check_hash) result.hash_match = unaligned_cast<uint32_t>(sr.hash_reserve.data(), 0) == sr.xenv.digest();
+      }
+      if(qm.clength != 0 && decompressed_bytes_read != qm.clength) throw std::runtime_error("Computed object length does not match recorded object length");
+    } else if(qm.compress_algorithm == 0 || qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
+      std::streampos current = myFile.tellg();
+      BlockIndex bi;
+      uint64_t hash_offset = 0; // the hash is located from the end of the file if there is a block index
+      if(qm.block_index) {
+        bi.readFromEnd(myFile);
+        myFile.seekg(0, std::ios::end);
+        hash_offset = static_cast<uint64_t>(myFile.tellg()) - bi.footerSize() - 4;
+        if(qm.element_index) {
+          ElementIndex ei;
+          ei.readFromEnd(myFile, bi);
+          hash_offset -= ei.footerSize();
+        }
+        myFile.seekg(current);
+      }
+      if(qm.compress_algorithm == 0) {
+        verify_blocks<zstd_decompress_env>(myFile, qm, bi, nthreads, hash_offset, result);
+      } else {
+        verify_blocks<lz4_decompress_env>(myFile, qm, bi, nthreads, hash_offset, result);
+      }
+    } else {
+      throw std::runtime_error("unknown compression");
+    }
+  } catch(std::exception & e) {
+    error = e.what();
+  }
+  myFile.close();
+  List outvec;
+  outvec["ok"] = result.corrupt_blocks.empty() && result.hash_match != FALSE && error.empty();
+  outvec["hash"] = qm.block_hash ? "block" : (qm.check_hash ? "object" : "none");
+  outvec["hash_match"] = LogicalVector::create(result.hash_match);
+  outvec["number_of_blocks"] = static_cast<double>(result.number_of_blocks);
+  outvec["corrupt_blocks"] = result.corrupt_blocks;
+  outvec["errors"] = result.errors;
+  outvec["error"] = error.empty() ? CharacterVector::create(NA_STRING) : CharacterVector::create(error);
+  return outvec;
+}
+
+// named counts of the object header types seen, types that were not seen are left out
+inline NumericVector headerCounts(const std::vector<uint64_t> & header_counts) {
+  std::vector<double> counts;
+  std::vector<std::string> types;
+  for(int i=0; i<QSTYPE_COUNT; i++) {
+    if(header_counts[i] == 0) continue;
+    counts.push_back(static_cast<double>(header_counts[i]));
+    types.push_back(qtypestr(static_cast<qstype>(i)));
+  }
+  NumericVector ret = wrap(counts);
+  ret.attr("names") = types;
+  return ret;
+}
+
+// comma separated header types set in a bitmask of Inspect_Context::header_types
+inline std::string headerTypes(const uint32_t types) {
+  std::string ret;
+  for(int i=0; i<QSTYPE_COUNT; i++) {
+    if(!(types & (1u << i))) continue;
+    if(!ret.empty()) ret += ",";
+    ret += qtypestr(static_cast<qstype>(i));
+  }
+  return ret;
+}
+
+template <class decompress_env>
+void inspect_blocks(std::ifstream & myFile, const QsMetadata & qm, const std::unordered_set<uint64_t> & dump_blocks, List & outvec) {
+  Inspect_Context<decompress_env> ic(myFile, qm);
+  ic.dump_blocks = dump_blocks;
+  std::string error;
+  std::string recorded_hash;
+  try {
+    inspectObject(&ic);
+    ic.finish();
+    if(qm.check_hash) recorded_hash = std::to_string(readSize4(myFile));
+  } catch(std::exception & e) {
+    error = e.what();
+  }
+  uint64_t nblocks = ic.blocks_read();
+  double compressed_bytes = 0;
+  double decompressed_bytes = 0;
+  std::vector<double> block_ratios(nblocks);
+  std::vector<std::string> computed_block_hashes(nblocks);
+  std::vector<std::string> recorded_block_hashes(qm.block_hash ? nblocks : 0);
+  LogicalVector block_hash_match(qm.block_hash ? nblocks : 0);
+  std::vector<std::string> block_header_types(nblocks);
+  for(uint64_t i=0; i<nblocks; i++) {
+    compressed_bytes += ic.zblock_sizes[i];
+    decompressed_bytes += ic.block_sizes[i];
+    block_ratios[i] = ic.block_sizes[i] / ic.zblock_sizes[i];
+    computed_block_hashes[i] = std::to_string(ic.computed_block_hashes[i]);
+    if(qm.block_hash) {
+      recorded_block_hashes[i] = std::to_string(ic.recorded_block_hashes[i]);
+      block_hash_match[i] = ic.computed_block_hashes[i] == ic.recorded_block_hashes[i];
+    }
+    block_header_types[i] = headerTypes(ic.header_types[i]);
+  }
+  outvec["number_of_blocks"] = static_cast<double>(nblocks);
+  outvec["compressed_bytes"] = compressed_bytes;
+  outvec["decompressed_bytes"] = decompressed_bytes;
+  outvec["compression_ratio"] = decompressed_bytes / compressed_bytes;
+  outvec["compressed_block_sizes"] = ic.zblock_sizes;
+  outvec["decompressed_block_sizes"] = ic.block_sizes;
+  outvec["block_compression_ratios"] = block_ratios;
+  outvec["block_stored_raw"] = LogicalVector(ic.stored_raw.begin(), ic.stored_raw.end());
+  outvec["computed_block_hashes"] = computed_block_hashes;
+  if(qm.block_hash) {
+    outvec["recorded_block_hashes"] = recorded_block_hashes;
+    outvec["block_hash_match"] = block_hash_match;
+  }
+  outvec["block_header_types"] = block_header_types;
+  outvec["header_counts"] = headerCounts(ic.header_counts);
+  if(qm.check_hash) {
+    outvec["computed_hash"] = std::to_string(ic.xenv.digest());
+    if(!recorded_hash.empty()) outvec["recorded_hash"] = recorded_hash;
+  }
+  if(!dump_blocks.empty()) {
+    List compressed_data(ic.dumped_blocks.size());
+    List uncompressed_data(ic.dumped_blocks.size());
+    std::vector<std::string> names(ic.dumped_blocks.size());
+    for(uint64_t i=0; i<ic.dumped_blocks.size(); i++) {
+      compressed_data[i] = RawVector(ic.dumped_zdata[i].begin(), ic.dumped_zdata[i].end());
+      uncompressed_data[i] = RawVector(ic.dumped_data[i].begin(), ic.dumped_data[i].end());
+      names[i] = std::to_string(ic.dumped_blocks[i] + 1);
+    }
+    compressed_data.attr("names") = names;
+    uncompressed_data.attr("names") = names;
+    outvec["compressed_data"] = compressed_data;
+    outvec["uncompressed_data"] = uncompressed_data;
+  }
+  outvec["error"] = error.empty() ? CharacterVector::create(NA_STRING) : CharacterVector::create(error);
+}
+
+template <class DestreamClass>
+void inspect_stream(std::ifstream & myFile, const QsMetadata & qm, const double compressed_bytes, List & outvec) {
+  DestreamClass sr(myFile, qm);
+  Inspect_Context_Stream<DestreamClass> ic(sr, qm);
+  std::string error;
+  try {
+    inspectObject(&ic);
+  } catch(std::exception & e) {
+    error = e.what();
+  }
+  double decompressed_bytes = static_cast<double>(sr.decompressed_bytes_read);
+  outvec["compressed_bytes"] = compressed_bytes;
+  outvec["decompressed_bytes"] = decompressed_bytes;
+  outvec["compression_ratio"] = decompressed_bytes / compressed_bytes;
+  outvec["header_counts"] = headerCounts(ic.header_counts);
+  if(qm.check_hash) {
+    outvec["computed_hash"] = std::to_string(sr.xenv.digest());
+    outvec["recorded_hash"] = std::to_string(unaligned_cast<uint32_t>(sr.hash_reserve.data(), 0));
+  }
+  outvec["error"] = error.empty() ? CharacterVector::create(NA_STRING) : CharacterVector::create(error);
+}
+
+// streaming alternative to qdump: statistics are collected while reading through the file, only the
+// current block and the blocks selected for dumping are kept in memory
+// [[Rcpp::export(rng = false)]]
+List qinspect(const std::string & file, SEXP const blocks = R_NilValue) {
+  std::unordered_set<uint64_t> dump_blocks; // counting from 0
+  if(blocks != R_NilValue) {
+    if(TYPEOF(blocks) != INTSXP && TYPEOF(blocks) != REALSXP) throw std::runtime_error("blocks must be a numeric vector");
+    NumericVector block_numbers(blocks);
+    for(double b : block_numbers) {
+      if(!(b >= 1)) throw std::runtime_error("block numbers must be positive");
+      dump_blocks.insert(static_cast<uint64_t>(b) - 1);
+    }
+  }
+  std::ifstream myFile(R_ExpandFileName(file.c_str()), std::ios::in | std::ios::binary);
+  if(!myFile) {
+    throw std::runtime_error("For file " + file + ": " + FILE_READ_ERR_MSG);
+  }
+  QsMetadata qm = QsMetadata::create(myFile);
+  List outvec;
+  dumpMetadata(outvec, qm);
+  if(qm.compress_algorithm == 3 || qm.compress_algorithm == 4) { // zstd_stream or uncompressed
+    if(!dump_blocks.empty()) throw std::runtime_error("blocks can only be dumped from files with block compression");
+    std::streampos current = myFile.tellg();
+    myFile.seekg(0, std::ios::end);
+    double compressed_bytes = static_cast<double>(myFile.tellg() - current) - (qm.check_hash ? 4 : 0);
+    myFile.seekg(current);
+    if(qm.compress_algorithm == 3) {
+      inspect_stream<ZSTD_streamRead<std::ifstream>>(myFile, qm, compressed_bytes, outvec);
+    } else {
+      inspect_stream<uncompressed_streamRead<std::ifstream>>(myFile, qm, compressed_bytes, outvec);
+    }
+  } else if(qm.compress_algorithm == 0) {
+    inspect_blocks<zstd_decompress_env>(myFile, qm, dump_blocks, outvec);
+  } else if(qm.compress_algorithm == 1 || qm.compress_algorithm == 2) {
+    inspect_blocks<lz4_decompress_env>(myFile, qm, dump_blocks, outvec);
+  } else {
+    outvec["error"] = "unknown compression";
+  }
+  myFile.close();
+  return outvec;
+}
+
 // [[Rcpp::export(rng = false)]]
 int openFd(const std::string & file, const std::string & mode) {
   if(mode == "w") {
@@ -851,6 +1441,42 @@ bool set_trust_promises(bool value) {
   return previous_value;
 }
 
+// [[Rcpp::export(rng = false)]]
+int set_thread_pool_size(const int nthreads) {
+  if(nthreads < 0) throw std::runtime_error("nthreads must be a non-negative integer");
+  int previous_value = thread_pool().size();
+  thread_pool().resize(nthreads);
+  return previous_value;
+}
+
+// samples are serialized uncompressed, the same data that is split into blocks and compressed by qserialize
+// [[Rcpp::export(rng = false)]]
+RawVector zstd_train_dictionary(List x, const int dict_size=112640, const int shuffle_control=15) {
+  if(dict_size < 1024) throw std::runtime_error("dict_size must be at least 1024");
+  QsMetadata qm("custom", "uncompressed", 0, shuffle_control, false);
+  vec_wrapper myFile;
+  std::vector<char> samples;
+  std::vector<size_t> sample_sizes;
+  for(R_xlen_t i=0; i<x.size(); i++) {
+    myFile.bytes_processed = 0;
+    uncompressed_streamWrite<vec_wrapper> sw(myFile, qm);
+    CompressBufferStream<uncompressed_streamWrite<vec_wrapper>> vbuf(sw, qm);
+    writeObject(&vbuf, VECTOR_ELT(x, i));
+    samples.insert(samples.end(), myFile.buffer.begin(), myFile.buffer.begin() + myFile.bytes_processed);
+    sample_sizes.push_back(myFile.bytes_processed);
+  }
+  std::vector<char> dict(dict_size);
+  size_t ret = ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(), sample_sizes.data(), sample_sizes.size());
+  if(ZDICT_isError(ret)) throw std::runtime_error(std::string("zstd dictionary training failed: ") + ZDICT_getErrorName(ret));
+  return RawVector(dict.begin(), dict.begin() + ret);
+}
+
+// [[Rcpp::export(rng = false)]]
+double register_zstd_dictionary(SEXP const dictionary) {
+  if(TYPEOF(dictionary) != RAWSXP) throw std::runtime_error("dictionary must be a raw vector, see zstd_train_dictionary");
+  return zstd_dictionaries().add(reinterpret_cast<char*>(RAW(dictionary)), Rf_xlength(dictionary));
+}
+
 
 // std::vector<unsigned char> brotli_compress_raw(RawVector x, int compress_level) {
 //   uint64_t zsize = BrotliEncoderMaxCompressedSize(x.size());
@@ -55,17 +55,24 @@
 //   }
 // };
 
-template <class decompress_env>
+template <class stream_reader, class decompress_env>
 struct Data_Thread_Context {
-  std::ifstream & myFile;
-  decompress_env denv; // default constructor
+  stream_reader & myFile;
   const unsigned int nthreads;
+  std::vector<decompress_env> denvs; // one per thread
 
-  uint64_t blocks_total;
+  std::atomic<uint64_t> blocks_total; // not known until the zero length block is read if the file has one
   std::atomic<uint64_t> blocks_read;
   std::atomic<uint64_t>  blocks_processed;
+  std::atomic<bool> aborted;
+  std::atomic<bool> failed;
+  std::string error_message; // written before failed is set, by the first worker that fails
+  std::mutex error_mutex;
 
-  std::vector<bool> primary_block = std::vector<bool>(nthreads, true);
+  uint64_t block_size; // uncompressed size of a full block
+  bool raw_blocks; // see raw_block_flag
+  bool block_hash; // see block_hash_flag, each thread verifies the blocks it decompresses
+  std::vector<uint8_t> primary_block = std::vector<uint8_t>(nthreads, 1); // not vector<bool>, each thread writes its own element
   std::vector< std::vector<char> > zblocks; // one per thread
   std::vector< std::vector<char> > data_blocks; // one per thread
   std::vector< std::vector<char> > data_blocks2; // one per thread
@@ -74,13 +81,16 @@ struct Data_Thread_Context {
   std::vector< std::atomic<char*> > block_pointers;
   std::vector< std::atomic<uint64_t> > block_sizes;
   std::vector< std::atomic<uint8_t> > data_task;
-  std::vector<std::thread> threads;
+  ThreadSignal signal; // notified on every change to blocks_total, blocks_read, data_task, aborted and failed
+  TaskGroup workers; // worker_thread tasks running on the global thread pool
 
-  Data_Thread_Context(std::ifstream & mf, unsigned int nt, QsMetadata qm) :
-    myFile(mf), nthreads(nt), blocks_total(qm.clength), blocks_read(0), blocks_processed(0),
-    zblocks(std::vector< std::vector<char> >(nt, std::vector<char>(this->denv.compressBound(BLOCKSIZE)))),
-    data_blocks(std::vector< std::vector<char> >(nt, std::vector<char>(BLOCKSIZE))),
-    data_blocks2(std::vector<std::vector<char> >(nt, std::vector<char>(BLOCKSIZE))) {
+  Data_Thread_Context(stream_reader & mf, unsigned int nt, QsMetadata qm) :
+    myFile(mf), nthreads(nt), denvs(nt),
+    blocks_total(qm.block_sentinel ? std::numeric_limits<uint64_t>::max() : qm.clength), blocks_read(0), blocks_processed(0), aborted(false), failed(false),
+    block_size(qm.block_size), raw_blocks(qm.raw_blocks), block_hash(qm.block_hash),
+    zblocks(std::vector< std::vector<char> >(nt, std::vector<char>(this->denvs[0].compressBound(qm.block_size)))),
+    data_blocks(std::vector< std::vector<char> >(nt, std::vector<char>(qm.block_size))),
+    data_blocks2(std::vector<std::vector<char> >(nt, std::vector<char>(qm.block_size))) {
     block_pointers = std::vector< std::atomic<char*> >(nt);
     for(unsigned int i=0; i<nt; i++) {
       block_pointers[i] = nullptr;
@@ -94,21 +104,53 @@ struct Data_Thread_Context {
       data_task[i] = 0;
     }
     for (unsigned int i = 0; i < nt; i++) {
-      threads.push_back(std::thread(&Data_Thread_Context::worker_thread, this, i));
+      thread_pool().submit(workers, [this, i]{ worker_thread(i); });
     }
   }
 
+  // exceptions must not escape a pool task: the error is passed to the main thread, which throws it
   void worker_thread(unsigned int thread_id) {
+    try {
+      read_blocks(thread_id);
+    } catch(std::exception & e) {
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if(!failed) error_message = e.what();
+        failed = true;
+      }
+      aborted = true;
+      signal.notify();
+    }
+  }
+  void check_failed() {
+    if(failed) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      throw std::runtime_error(error_message);
+    }
+  }
+
+  void read_blocks(unsigned int thread_id) {
     std::array<char,4> zsize_ar;
     for(uint64_t i=thread_id; i < blocks_total; i += nthreads) {
       // tout << thread_id << " " << i <<  "begin\n" << std::flush;
-      while(blocks_read != i) {
-        std::this_thread::yield();
-      }
-      myFile.read(zsize_ar.data(), 4);
+      signal.wait([this, i]{ return blocks_read == i || i >= blocks_total || aborted; });
+      if(aborted || i >= blocks_total) return;
+      read_allow(myFile, zsize_ar.data(), 4);
       uint32_t zsize = unaligned_cast<uint32_t>(zsize_ar.data(),0);
-      myFile.read(zblocks[thread_id].data(), zsize);
+      if(zsize == 0) { // end of block data, the other threads stop at their next block
+        blocks_total = i;
+        signal.notify();
+        return;
+      }
+      uint64_t recorded_hash = block_hash ? readSize8(myFile) : 0;
+      // blocks stored as is are read straight into the data block while this thread holds the file
+      char* dp = primary_block[thread_id] ? data_blocks[thread_id].data() : data_blocks2[thread_id].data();
+      bool raw = raw_blocks && (zsize & RAW_BLOCK_BIT);
+      uint64_t payload_size = block_payload_size(zsize);
+      if(payload_size > (raw ? block_size : zblocks[thread_id].size())) throw std::runtime_error("Malformed compress block: size > compress bound");
+      read_allow(myFile, raw ? dp : zblocks[thread_id].data(), payload_size);
       blocks_read++;
+      signal.notify();
 
       // task marching orders from main thread
       // 0 = wait
@@ -119,18 +161,13 @@ struct Data_Thread_Context {
       // if(data_task[thread_id] == 2) {
       //   char* dp = data_pass.first;
       //   data_task[thread_id] = 0;
-      //   decompFun(dp, BLOCKSIZE, zblocks[thread_id].data(), zsize);
+      //   decompFun(dp, block_size, zblocks[thread_id].data(), zsize);
       // } else {
-      if(primary_block[thread_id]) {
-        block_sizes[thread_id] = denv.decompress(data_blocks[thread_id].data(), BLOCKSIZE, zblocks[thread_id].data(), zsize);
-        block_pointers[thread_id] = data_blocks[thread_id].data();
-      } else {
-        block_sizes[thread_id] = denv.decompress(data_blocks2[thread_id].data(), BLOCKSIZE, zblocks[thread_id].data(), zsize);
-        block_pointers[thread_id] = data_blocks2[thread_id].data();
-      }
-      while(data_task[thread_id] == 0) {
-        std::this_thread::yield();
-      }
+      block_sizes[thread_id] = raw ? payload_size : denvs[thread_id].decompress(dp, block_size, zblocks[thread_id].data(), zsize);
+      if(block_hash) checkBlockHash(dp, block_sizes[thread_id], recorded_hash, i + 1);
+      block_pointers[thread_id] = dp;
+      signal.wait([this, thread_id]{ return data_task[thread_id] != 0 || aborted; });
+      if(aborted) return;
       if(data_task[thread_id] == 1) {
         data_pass.first = block_pointers[thread_id];
         data_pass.second = block_sizes[thread_id];
@@ -140,6 +177,7 @@ struct Data_Thread_Context {
         std::memcpy(dp, block_pointers[thread_id], block_sizes[thread_id]);
         data_task[thread_id] = 0;
       }
+      signal.notify();
       // }
 
       primary_block[thread_id] = !primary_block[thread_id];
@@ -149,40 +187,54 @@ struct Data_Thread_Context {
 
   void finish() {
     blocks_processed++;
-    for(unsigned int i=0; i < nthreads; i++) {
-      // tout << "join called " << i << "\n" << std::flush;
-      threads[i].join();
-    }
+    workers.wait();
+    check_failed();
+  }
+  // the tasks reference this context, stop them if an error skipped finish()
+  ~Data_Thread_Context() {
+    aborted = true;
+    signal.notify();
+    workers.wait();
   }
 
   std::pair<char*, uint64_t> get_block_ptr() {
-    uint64_t current_block = blocks_processed % nthreads;
-    blocks_processed++;
-    while(data_task[current_block] != 0) std::this_thread::yield();
+    uint64_t block = blocks_processed++;
+    uint64_t current_block = block % nthreads;
+    signal.wait([this, current_block]{ return data_task[current_block] == 0 || failed; });
+    check_failed();
     data_task[current_block] = 1;
-    while(data_task[current_block] != 0) std::this_thread::yield();
+    signal.notify();
+    signal.wait([this, current_block, block]{ return data_task[current_block] == 0 || block >= blocks_total || failed; });
+    check_failed();
+    if(data_task[current_block] != 0) throw std::runtime_error("QS format error: unexpected end of block data");
     char* temp_ptr = data_pass.first;
     uint64_t temp_size = data_pass.second;
     return std::pair<char*, uint64_t>(temp_ptr, temp_size);
   }
 
   void decompress_data_direct(char* bpointer) {
-    uint64_t current_block = blocks_processed % nthreads;
-    blocks_processed++;
-    while(data_task[current_block] != 0) std::this_thread::yield();
+    uint64_t block = blocks_processed++;
+    uint64_t current_block = block % nthreads;
+    signal.wait([this, current_block]{ return data_task[current_block] == 0 || failed; });
+    check_failed();
     data_pass.first = bpointer;
     data_task[current_block] = 2;
-    while(data_task[current_block] != 0) std::this_thread::yield();
+    signal.notify();
+    signal.wait([this, current_block, block]{ return data_task[current_block] == 0 || block >= blocks_total || failed; });
+    check_failed();
+    if(data_task[current_block] != 0) throw std::runtime_error("QS format error: unexpected end of block data");
   }
 };
 
-template <class decompress_env>
+template <class stream_reader, class decompress_env>
 struct Data_Context_MT {
   QsMetadata qm;
-  std::ifstream & myFile;
-  Data_Thread_Context<decompress_env> dtc;
+  stream_reader & myFile;
+  Data_Thread_Context<stream_reader, decompress_env> dtc;
   xxhash_env xenv;
   std::unordered_map<uint32_t, SEXP> object_ref_hash;
+  StringTable string_table; // see string_dedup_flag
+  ColumnarStringData columnar; // scratch space of readCharacterColumnar, reused for every vector read
   bool use_alt_rep_bool;
 
   std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
@@ -190,8 +242,8 @@ struct Data_Context_MT {
   uint64_t block_size = 0;
   uint64_t data_offset = 0;
 
-  Data_Context_MT(std::ifstream & mf, QsMetadata qm, bool use_alt_rep, unsigned int nthreads) :
-    qm(qm), myFile(mf), dtc(mf, nthreads-1, qm), use_alt_rep_bool(use_alt_rep) {}
+  Data_Context_MT(stream_reader & mf, QsMetadata qm, bool use_alt_rep, unsigned int nthreads) :
+    qm(qm), myFile(mf), dtc(mf, thread_pool().concurrency(nthreads-1), qm), use_alt_rep_bool(use_alt_rep) {}
   void readHeader(qstype & object_type, uint64_t & r_array_len) {
     if(data_offset >= block_size) decompress_block();
     char* header = block_data;
@@ -209,7 +261,7 @@ struct Data_Context_MT {
   }
   void decompress_direct(char* bpointer) {
     dtc.decompress_data_direct(bpointer);
-    if(qm.check_hash) xenv.update(bpointer, BLOCKSIZE);
+    if(qm.check_hash) xenv.update(bpointer, qm.block_size);
   }
   void decompress_block() {
     auto res = dtc.get_block_ptr();
@@ -219,6 +271,12 @@ struct Data_Context_MT {
     if(qm.check_hash) xenv.update(block_data, block_size);
     // tout << "main thread decompress block " << (void *)block_data << " " << block_size << "\n" << std::flush;
   }
+  // payload alignment is only used by the uncompressed format
+  void alignData(const uint64_t data_size) {}
+  // lazy vectors need random access into the file (see Data_Context), always read eagerly
+  SEXP lazyVector(const SEXPTYPE type, const uint64_t length, const uint64_t bytesoftype, const bool shuffle) {
+    return R_NilValue;
+  }
   void getBlockData(char* outp, uint64_t data_size) {
     // tout << "main thread get block data " << data_size << " " << block_size << " " << data_offset << "\n" << std::flush;
     if(data_size <= block_size - data_offset) {
@@ -228,10 +286,10 @@ struct Data_Context_MT {
       uint64_t bytes_accounted = block_size - data_offset;
       std::memcpy(outp, block_data+data_offset, bytes_accounted);
       while(bytes_accounted < data_size) {
-        if(data_size - bytes_accounted >= BLOCKSIZE) {
+        if(data_size - bytes_accounted >= qm.block_size) {
           decompress_direct(outp+bytes_accounted);
-          bytes_accounted += BLOCKSIZE;
-          data_offset = BLOCKSIZE;
+          bytes_accounted += qm.block_size;
+          data_offset = qm.block_size;
         } else {
           decompress_block();
           std::memcpy(outp + bytes_accounted, block_data, data_size - bytes_accounted);
@@ -264,3 +322,126 @@ struct Data_Context_MT {
     }
   }
 };
+
+////////////////////////////////////////////////////////////////
+// integrity check of block compressed files without deserialization (qverify)
+////////////////////////////////////////////////////////////////
+
+// each worker takes the next block, reads it while holding the file, then decompresses and hashes it on its own
+// with the block index every block is read from its recorded file offset, so a corrupted block size does not hide the blocks after it
+// the hash of the whole object needs the blocks in order: a worker adds its block to xenv after the preceding blocks
+template <class decompress_env>
+struct Verify_Thread_Context {
+  std::ifstream & myFile;
+  QsMetadata qm;
+  const BlockIndex & bi; // empty if the file has no block index
+  unsigned int nthreads;
+  std::vector<decompress_env> denvs; // one per thread
+  std::vector< std::vector<char> > zblocks; // one per thread
+  std::vector< std::vector<char> > data_blocks; // one per thread
+
+  // only modified while holding file_mutex
+  std::mutex file_mutex;
+  uint64_t blocks_total; // not known until the zero length block is read if the file has neither a block index nor a block count
+  uint64_t blocks_claimed = 0;
+  bool end_of_data = false; // the end of the last block read, i.e. the position of the hash, is known
+
+  xxhash_env xenv; // if qm.check_hash
+  std::atomic<uint64_t> blocks_hashed;
+  ThreadSignal signal; // notified on every change to blocks_hashed
+
+  std::mutex result_mutex;
+  std::vector< std::pair<uint64_t, std::string> > corrupt_blocks; // block number counting from 1 and the error
+  TaskGroup workers;
+
+  Verify_Thread_Context(std::ifstream & mf, QsMetadata qm, const BlockIndex & bi, unsigned int nt) :
+    myFile(mf), qm(qm), bi(bi), nthreads(nt > 1 ? thread_pool().concurrency(nt) : 1), denvs(nthreads),
+    zblocks(std::vector< std::vector<char> >(nthreads, std::vector<char>(this->denvs[0].compressBound(qm.block_size)))),
+    data_blocks(std::vector< std::vector<char> >(nthreads, std::vector<char>(qm.block_size))),
+    blocks_total(qm.block_index ? bi.size() : (qm.block_sentinel ? std::numeric_limits<uint64_t>::max() : qm.clength)),
+    blocks_hashed(0) {}
+
+  // the main thread is the only worker if nthreads is 1
+  void run() {
+    if(nthreads <= 1) {
+      worker_thread(0);
+      return;
+    }
+    for (unsigned int i = 0; i < nthreads; i++) {
+      thread_pool().submit(workers, [this, i]{ worker_thread(i); });
+    }
+    workers.wait();
+  }
+
+  // reads the next block into the buffers of thread_id, returns false if there are no more blocks
+  // without the block index a block that can't be read also ends the data, since the next block can't be located
+  bool read_block(unsigned int thread_id, uint64_t & block, uint64_t & zsize, uint64_t & recorded_hash, std::string & error) {
+    std::lock_guard<std::mutex> lock(file_mutex);
+    if(blocks_claimed >= blocks_total) return false;
+    block = blocks_claimed++;
+    try {
+      if(qm.block_index) {
+        myFile.clear();
+        myFile.seekg(bi.file_offsets[block]);
+      }
+      zsize = readSize4(myFile);
+      if(zsize == 0 && qm.block_sentinel && !qm.block_index) {
+        blocks_total = block;
+        end_of_data = true;
+        return false;
+      }
+      if(qm.block_hash) recorded_hash = readSize8(myFile);
+      bool raw = qm.raw_blocks && (zsize & RAW_BLOCK_BIT);
+      uint64_t payload_size = block_payload_size(zsize);
+      if(payload_size > (raw ? qm.block_size : zblocks[thread_id].size())) throw std::runtime_error("Malformed compress block: size > compress bound");
+      read_check(myFile, raw ? data_blocks[thread_id].data() : zblocks[thread_id].data(), payload_size);
+      if(!qm.block_index && blocks_claimed == blocks_total) end_of_data = true;
+    } catch(std::exception & e) {
+      error = e.what();
+      if(!qm.block_index) blocks_total = blocks_claimed;
+    }
+    return true;
+  }
+
+  void verify_block(unsigned int thread_id, const uint64_t block, const uint64_t zsize, const uint64_t recorded_hash, uint64_t & bsize) {
+    if(qm.raw_blocks && (zsize & RAW_BLOCK_BIT)) {
+      bsize = block_payload_size(zsize);
+    } else {
+      bsize = denvs[thread_id].decompress(data_blocks[thread_id].data(), qm.block_size, zblocks[thread_id].data(), zsize);
+    }
+    if(qm.block_index) {
+      uint64_t end = block + 1 < bi.size() ? bi.decompressed_offsets[block + 1] : bi.decompressed_length;
+      if(bsize != end - bi.decompressed_offsets[block]) throw std::runtime_error("Decompressed block size does not match the block index");
+    }
+    if(qm.block_hash) checkBlockHash(data_blocks[thread_id].data(), bsize, recorded_hash, block + 1);
+  }
+
+  // exceptions must not escape a pool task: errors are recorded with the block
+  void worker_thread(unsigned int thread_id) {
+    uint64_t block, zsize, recorded_hash;
+    while(true) {
+      std::string error;
+      zsize = 0;
+      recorded_hash = 0;
+      if(!read_block(thread_id, block, zsize, recorded_hash, error)) break;
+      uint64_t bsize = 0;
+      if(error.empty()) {
+        try {
+          verify_block(thread_id, block, zsize, recorded_hash, bsize);
+        } catch(std::exception & e) {
+          error = e.what();
+        }
+      }
+      if(qm.check_hash) {
+        signal.wait([this, block]{ return blocks_hashed == block; });
+        if(error.empty()) xenv.update(data_blocks[thread_id].data(), bsize);
+        blocks_hashed++;
+        signal.notify();
+      }
+      if(!error.empty()) {
+        std::lock_guard<std::mutex> lock(result_mutex);
+        corrupt_blocks.push_back(std::make_pair(block + 1, error));
+      }
+    }
+  }
+};
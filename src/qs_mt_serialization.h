@@ -65,149 +65,194 @@ std::mutex ThreadStream::_mutex_threadstream{};
 // multi-thread serialization functions
 ////////////////////////////////////////////////////////////////
 
-template <class compress_env> 
+// blocks are numbered in the order they are pushed and stored in a ring of nslots slots
+// any idle worker compresses the next unclaimed block, so a slow block only holds up its own worker
+// compressed blocks are written in order by whichever worker completes the block that is next in the file;
+// the ring bounds how far compression can run ahead of the oldest unwritten block
+static constexpr unsigned int REORDER_SLOTS_PER_THREAD = 2;
+
+template <class stream_writer, class compress_env> 
 struct Compress_Thread_Context {
-  std::ofstream* myFile;
-  compress_env cenv;
+  stream_writer* myFile;
+  unsigned int nthreads;
+  unsigned int nslots;
+  std::vector<compress_env> cenvs; // one per thread
   
-  std::atomic<uint64_t> blocks_total;
+  std::atomic<uint64_t> blocks_total; // pushed by the main thread
+  std::atomic<uint64_t> blocks_claimed; // taken by a worker
   std::atomic<uint64_t> blocks_written;
   
-  unsigned int nthreads;
   int compress_level;  
+  bool raw_blocks; // see raw_block_flag
+  bool block_hash; // see block_hash_flag
   std::atomic<bool> done;
+  std::atomic<bool> aborted;
+  std::atomic<bool> failed;
+  std::string error_message; // written before failed is set, by the first worker that fails
+  std::mutex error_mutex;
   
-  std::vector<std::vector<char> > zblocks; // one per thread
-  std::vector<std::vector<char> > data_blocks; // one per thread
-  std::vector< std::pair<const char*, uint64_t> > block_pointers;
+  // only modified while holding write_mutex
+  std::mutex write_mutex;
+  bool use_block_index;
+  uint64_t file_offset;
+  BlockIndex block_index;
   
-  std::vector< std::atomic<bool> > data_ready;
-  std::vector<std::thread> threads;
+  std::vector<std::vector<char> > zblocks; // one per slot
+  std::vector<std::vector<char> > data_blocks; // one per slot
+  std::vector< std::pair<const char*, uint64_t> > block_pointers; // one per slot
+  std::vector<uint64_t> zsizes; // one per slot
+  std::vector<uint64_t> hashes; // one per slot, if block_hash
+  
+  std::vector< std::atomic<bool> > data_ready; // slot holds a block that is not yet written
+  std::vector< std::atomic<bool> > compressed; // slot holds a compressed block that is not yet written
+  ThreadSignal signal; // notified on every change to blocks_total, data_ready, blocks_written, done, aborted and failed
+  TaskGroup workers; // worker_thread tasks running on the global thread pool
+  
+  bool claim_block(uint64_t & block) {
+    block = blocks_claimed;
+    while(block < blocks_total) {
+      if(blocks_claimed.compare_exchange_weak(block, block + 1)) return true;
+    }
+    return false;
+  }
   
+  // exceptions must not escape a pool task: the error is passed to the main thread, which throws it
   void worker_thread(unsigned int thread_id) {
-    while(!done) {
-      // check if data ready and then compress
-
-      // tout << "waiting on data " << blocks_written << " thread " << thread_id << "\n" << std::flush;
-
-      while (!data_ready[thread_id]) {
-        std::this_thread::yield();
-        if(done) break;
-      }; if(done) break;
-      
-      uint64_t zsize = cenv.compress(zblocks[thread_id].data(), zblocks[thread_id].size(), block_pointers[thread_id].first, block_pointers[thread_id].second, compress_level);
-      data_ready[thread_id] = false;
-
-      // tout << "data ready to write " << blocks_written << " thread " << thread_id << "\n" << std::flush;
-
-      // write to file
-      while (blocks_written % nthreads != thread_id) {
-        std::this_thread::yield();
+    try {
+      compress_blocks(thread_id);
+    } catch(std::exception & e) {
+      {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if(!failed) error_message = e.what();
+        failed = true;
       }
-      writeSize4(*myFile, zsize);
-      myFile->write(zblocks[thread_id].data(), zsize);
-      blocks_written += 1;
-
-      // tout << "blocks written " << blocks_written << " thread " << thread_id << "\n" << std::flush;
-
+      aborted = true;
+      signal.notify();
     }
-
-    // tout << "exit main loop " << blocks_written << " thread " << thread_id << "\n" << std::flush;
-
-    
-    // final check to see if any remaining data
-    if(data_ready[thread_id]) {
-      uint64_t zsize = cenv.compress(zblocks[thread_id].data(), zblocks[thread_id].size(), block_pointers[thread_id].first, block_pointers[thread_id].second, compress_level);
-
-      // tout << "final data ready to write " << blocks_written << " thread " << thread_id << "\n" << std::flush;
-
-      // write to file
-      while (blocks_written % nthreads != thread_id) {
-        std::this_thread::yield();
-      }
-      writeSize4(*myFile, zsize);
-      myFile->write(zblocks[thread_id].data(), zsize);
+  }
+  void check_failed() {
+    if(failed) {
+      std::lock_guard<std::mutex> lock(error_mutex);
+      throw std::runtime_error(error_message);
+    }
+  }
+  
+  void compress_blocks(unsigned int thread_id) {
+    while(true) {
+      uint64_t block;
+      bool claimed = false;
+      // done is set after the last push, so once it is seen blocks_total is final
+      signal.wait([this, &block, &claimed]{
+        if(aborted) return true;
+        claimed = claim_block(block);
+        return claimed || (done && blocks_claimed >= blocks_total);
+      });
+      if(!claimed) break;
+      uint64_t slot = block % nslots;
+      zsizes[slot] = compress_block(cenvs[thread_id], zblocks[slot].data(), zblocks[slot].size(),
+                                    block_pointers[slot].first, block_pointers[slot].second, compress_level, raw_blocks);
+      if(block_hash) hashes[slot] = blockHash(block_pointers[slot].first, block_pointers[slot].second);
+      compressed[slot] = true;
+      write_blocks();
+    }
+  }
+  
+  // write every compressed block that is next in the file
+  // a worker that finds the lock taken waits for it, so that a block completed during another worker's write is not missed
+  void write_blocks() {
+    std::lock_guard<std::mutex> lock(write_mutex);
+    while(true) {
+      uint64_t slot = blocks_written % nslots;
+      if(!compressed[slot]) break;
+      if(use_block_index) block_index.push_back(file_offset, block_pointers[slot].second);
+      writeSize4(*myFile, zsizes[slot]);
+      if(block_hash) writeSize8(*myFile, hashes[slot]);
+      uint64_t payload_size = block_payload_size(zsizes[slot]);
+      write_check(*myFile, (zsizes[slot] & RAW_BLOCK_BIT) ? block_pointers[slot].first : zblocks[slot].data(), payload_size);
+      file_offset += (block_hash ? 12 : 4) + payload_size;
+      compressed[slot] = false;
+      data_ready[slot] = false;
       blocks_written += 1;
-
-      // tout << "final blocks written " << blocks_written << " thread " << thread_id << "\n" << std::flush;
-
+      signal.notify();
     }
   }
   
   void finish() {
     done = true;
-    for(unsigned int i =0; i < nthreads; i++) {
-
-      // tout << "joining " << i << "\n" << std::flush;
-
-      threads[i].join();
-
-      // tout << "joined " << i << "\n" << std::flush;
-
-    }
+    signal.notify();
+    workers.wait();
+    check_failed();
+  }
+  // the tasks reference this context, stop them if an error skipped finish()
+  ~Compress_Thread_Context() {
+    aborted = true;
+    signal.notify();
+    workers.wait();
   }
   
-  Compress_Thread_Context(std::ofstream* mf, unsigned int nt, QsMetadata qm) : 
-    myFile(mf), blocks_total(0), blocks_written(0),
-    nthreads(nt-1), compress_level(qm.compress_level), done(false),
-    zblocks(std::vector< std::vector<char> >(nthreads, std::vector<char>(this->cenv.compressBound(BLOCKSIZE)))),
-    data_blocks(std::vector< std::vector<char> >(nthreads, std::vector<char>(BLOCKSIZE))),
-    block_pointers(std::vector< std::pair<const char*, uint64_t> >(nthreads)) {
+  Compress_Thread_Context(stream_writer* mf, unsigned int nt, QsMetadata qm) : 
+    myFile(mf), nthreads(thread_pool().concurrency(nt-1)), nslots(REORDER_SLOTS_PER_THREAD * nthreads), cenvs(nthreads),
+    blocks_total(0), blocks_claimed(0), blocks_written(0),
+    compress_level(qm.compress_level), raw_blocks(qm.raw_blocks), block_hash(qm.block_hash), done(false), aborted(false), failed(false),
+    use_block_index(qm.block_index), file_offset(QS_HEADER_LENGTH),
+    zblocks(std::vector< std::vector<char> >(nslots, std::vector<char>(this->cenvs[0].compressBound(qm.block_size)))),
+    data_blocks(std::vector< std::vector<char> >(nslots, std::vector<char>(qm.block_size))),
+    block_pointers(std::vector< std::pair<const char*, uint64_t> >(nslots)),
+    zsizes(nslots, 0), hashes(nslots, 0) {
     
-    data_ready = std::vector< std::atomic<bool> >(nthreads);
-    for(unsigned int i=0; i<nthreads; i++) {
+    data_ready = std::vector< std::atomic<bool> >(nslots);
+    compressed = std::vector< std::atomic<bool> >(nslots);
+    for(unsigned int i=0; i<nslots; i++) {
       data_ready[i] = false;
+      compressed[i] = false;
     }
     
     for (unsigned int i = 0; i < nthreads; i++) {
-      threads.push_back(std::thread(&Compress_Thread_Context::worker_thread, this, i));
+      cenvs[i].useDictionary(qm);
+    }
+    for (unsigned int i = 0; i < nthreads; i++) {
+      thread_pool().submit(workers, [this, i]{ worker_thread(i); });
     }
   }
   
   char* get_new_block_ptr() {
-
-    // tout << "new block\n" << std::flush;
-
-    uint64_t block_check = blocks_total % nthreads;
-    while (data_ready[block_check]) {
-      std::this_thread::yield();
-    }
-    block_pointers[block_check].first = data_blocks[block_check].data();
-    return data_blocks[block_check].data();
+    uint64_t slot = blocks_total % nslots;
+    signal.wait([this, slot]{ return !data_ready[slot] || failed; });
+    check_failed();
+    block_pointers[slot].first = data_blocks[slot].data();
+    return data_blocks[slot].data();
   }
   
   void push_block(const uint32_t datasize) {
-    uint64_t block_check = blocks_total % nthreads;
-
-    // tout << "push block " << block_check << "\n" << std::flush;
-
-    block_pointers[block_check].second = datasize;
-    data_ready[block_check] = true;
+    uint64_t slot = blocks_total % nslots;
+    block_pointers[slot].second = datasize;
+    data_ready[slot] = true;
     blocks_total++;
+    signal.notify();
   }
   
   void push_ptr(const char * const ptr, const uint32_t datasize) {
-    uint64_t block_check = blocks_total % nthreads;
-    
-    // tout << "push ptr " << block_check << "\n" << std::flush;
-
-    while (data_ready[block_check]) {
-      std::this_thread::yield();
-    }
-    block_pointers[block_check].first = ptr;
-    block_pointers[block_check].second = datasize;
-    data_ready[block_check] = true;
+    uint64_t slot = blocks_total % nslots;
+    signal.wait([this, slot]{ return !data_ready[slot] || failed; });
+    check_failed();
+    block_pointers[slot].first = ptr;
+    block_pointers[slot].second = datasize;
+    data_ready[slot] = true;
     blocks_total++;
+    signal.notify();
   }
 };
 
-template <class compress_env> 
+template <class stream_writer, class compress_env> 
 struct CompressBuffer_MT {
   QsMetadata qm;
-  std::ofstream * myFile;
+  stream_writer * myFile;
   xxhash_env xenv;
-  Compress_Thread_Context<compress_env> ctc;
+  Compress_Thread_Context<stream_writer, compress_env> ctc;
   CountToObjectMap object_ref_hash;
+  StringRefMap string_refs; // see string_dedup_flag
+  WriteStack write_stack; // scratch space of writeObject, reused for every object written
+  ElementIndex element_index;
   
   std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
   // shuffle_endblock is tracking when shuffleblock is finished processing
@@ -215,15 +260,28 @@ struct CompressBuffer_MT {
   
   uint64_t current_blocksize = 0;
   uint64_t number_of_blocks = 0;
+  uint64_t decompressed_bytes = 0; // uncompressed bytes pushed to ctc in full blocks
   char* block_data_ptr;
   
-  CompressBuffer_MT(std::ofstream * f, QsMetadata _qm, unsigned int nthreads) : qm(_qm), myFile(f), ctc(f, nthreads, _qm) {
+  CompressBuffer_MT(stream_writer * f, QsMetadata _qm, unsigned int nthreads) : qm(_qm), myFile(f), ctc(f, nthreads, _qm) {
     block_data_ptr = ctc.get_new_block_ptr();
   }
+  // position of the next byte pushed within the uncompressed data stream
+  uint64_t decompressed_offset() const {
+    return decompressed_bytes + current_blocksize;
+  }
+  // bytes that can be pushed before a header would have to start a new block, used to batch small vectors (writeSmallVectors)
+  uint64_t batch_capacity() const {
+    uint64_t available = qm.block_size - current_blocksize;
+    return available > BLOCKRESERVE ? available - BLOCKRESERVE : 0;
+  }
+  // payload alignment is only used by the uncompressed format
+  void alignData(const uint64_t data_size) {}
   void flush() {
     if(current_blocksize > 0) {
       ctc.push_block(current_blocksize);
       number_of_blocks++;
+      decompressed_bytes += current_blocksize;
       current_blocksize = 0;
       block_data_ptr = ctc.get_new_block_ptr();
     }
@@ -232,17 +290,18 @@ struct CompressBuffer_MT {
     if(qm.check_hash) xenv.update(data, len);
     uint64_t current_pointer_consumed = 0;
     while(current_pointer_consumed < len) {
-      if( current_blocksize == BLOCKSIZE ) {
+      if( current_blocksize == qm.block_size ) {
         flush();
       }
-      if(current_blocksize == 0 && len - current_pointer_consumed >= BLOCKSIZE) {
-        ctc.push_ptr(data + current_pointer_consumed, BLOCKSIZE);
-        current_pointer_consumed += BLOCKSIZE;
+      if(current_blocksize == 0 && len - current_pointer_consumed >= qm.block_size) {
+        ctc.push_ptr(data + current_pointer_consumed, qm.block_size);
+        current_pointer_consumed += qm.block_size;
         block_data_ptr = ctc.get_new_block_ptr();
         number_of_blocks++;
+        decompressed_bytes += qm.block_size;
       } else {
         uint64_t remaining_pointer_available = len - current_pointer_consumed;
-        uint64_t add_length = remaining_pointer_available < (BLOCKSIZE - current_blocksize) ? remaining_pointer_available : BLOCKSIZE-current_blocksize;
+        uint64_t add_length = remaining_pointer_available < (qm.block_size - current_blocksize) ? remaining_pointer_available : qm.block_size-current_blocksize;
         std::memcpy(block_data_ptr + current_blocksize, data + current_pointer_consumed, add_length);
         current_blocksize += add_length;
         current_pointer_consumed += add_length;
@@ -253,17 +312,18 @@ struct CompressBuffer_MT {
     if(qm.check_hash) xenv.update(data, len);
     uint64_t current_pointer_consumed = 0;
     while(current_pointer_consumed < len) {
-      if( BLOCKSIZE - current_blocksize < BLOCKRESERVE ) {
+      if( qm.block_size - current_blocksize < BLOCKRESERVE ) {
         flush();
       }
-      if(current_blocksize == 0 && len - current_pointer_consumed >= BLOCKSIZE) {
-        ctc.push_ptr(data + current_pointer_consumed, BLOCKSIZE);
-        current_pointer_consumed += BLOCKSIZE;
+      if(current_blocksize == 0 && len - current_pointer_consumed >= qm.block_size) {
+        ctc.push_ptr(data + current_pointer_consumed, qm.block_size);
+        current_pointer_consumed += qm.block_size;
         block_data_ptr = ctc.get_new_block_ptr();
         number_of_blocks++;
+        decompressed_bytes += qm.block_size;
       } else {
         uint64_t remaining_pointer_available = len - current_pointer_consumed;
-        uint64_t add_length = remaining_pointer_available < (BLOCKSIZE - current_blocksize) ? remaining_pointer_available : BLOCKSIZE-current_blocksize;
+        uint64_t add_length = remaining_pointer_available < (qm.block_size - current_blocksize) ? remaining_pointer_available : qm.block_size-current_blocksize;
         std::memcpy(block_data_ptr + current_blocksize, data + current_pointer_consumed, add_length);
         current_blocksize += add_length;
         current_pointer_consumed += add_length;
@@ -288,15 +348,11 @@ struct CompressBuffer_MT {
   void shuffle_push(const char * const data, const uint64_t len, const uint64_t bytesoftype) {
     if(len > MIN_SHUFFLE_ELEMENTS) {
       // blocks_written = number of blocks file written
-      // (len + current_blocksize)/BLOCKSIZE = additional full blocks due to shuffleblock
+      // (len + current_blocksize)/block size = additional full blocks due to shuffleblock
       // number_of_blocks = number of blocks pushed to ctc
-      while( shuffle_endblock > ctc.blocks_written ) {
-        
-        // tout << "shuffle " << shuffle_endblock << " " << ctc.blocks_written << "\n" << std::flush;
-        
-        std::this_thread::yield();
-      }
-      shuffle_endblock = (len + current_blocksize)/BLOCKSIZE + number_of_blocks;
+      ctc.signal.wait([this]{ return shuffle_endblock <= ctc.blocks_written || ctc.failed; });
+      ctc.check_failed();
+      shuffle_endblock = (len + current_blocksize)/qm.block_size + number_of_blocks;
       if(len > shuffleblock.size()) shuffleblock.resize(len);
       blosc_shuffle(reinterpret_cast<const uint8_t * const>(data), shuffleblock.data(), len, bytesoftype);
       push_contiguous(reinterpret_cast<char*>(shuffleblock.data()), len);
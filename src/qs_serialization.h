@@ -32,37 +32,63 @@ struct CompressBuffer {
   compress_env cenv; // default constructor
   xxhash_env xenv; // default constructor
   CountToObjectMap object_ref_hash; // default constructor
+  StringRefMap string_refs; // see string_dedup_flag
+  WriteStack write_stack; // scratch space of writeObject, reused for every object written
   uint64_t number_of_blocks = 0;
+  uint64_t file_offset = QS_HEADER_LENGTH; // position of the next block relative to start of header
+  BlockIndex block_index;
+  ElementIndex element_index;
+  uint64_t decompressed_bytes = 0; // uncompressed bytes written out in full blocks
   std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
-  std::vector<char> block = std::vector<char>(BLOCKSIZE);
+  std::vector<char> block = std::vector<char>(qm.block_size);
   uint64_t current_blocksize=0;
-  std::vector<char> zblock = std::vector<char>(cenv.compressBound(BLOCKSIZE));
-  CompressBuffer(stream_writer & f, QsMetadata qm) : qm(qm), myFile(f) {}
+  std::vector<char> zblock = std::vector<char>(cenv.compressBound(qm.block_size));
+  CompressBuffer(stream_writer & f, QsMetadata qm) : qm(qm), myFile(f) {
+    cenv.useDictionary(qm);
+  }
+  // src is the uncompressed data of the block, written instead of zblock if the block is stored as is
+  void write_block(const uint64_t zsize, const char * const src, const uint64_t blocksize) {
+    if(qm.block_index) block_index.push_back(file_offset, blocksize);
+    writeSize4(myFile, zsize);
+    if(qm.block_hash) writeSize8(myFile, blockHash(src, blocksize));
+    uint64_t payload_size = block_payload_size(zsize);
+    write_check(myFile, (zsize & RAW_BLOCK_BIT) ? src : zblock.data(), payload_size);
+    file_offset += (qm.block_hash ? 12 : 4) + payload_size;
+    decompressed_bytes += blocksize;
+    number_of_blocks++;
+  }
+  // position of the next byte pushed within the uncompressed data stream
+  uint64_t decompressed_offset() const {
+    return decompressed_bytes + current_blocksize;
+  }
+  // bytes that can be pushed before a header would have to start a new block, used to batch small vectors (writeSmallVectors)
+  uint64_t batch_capacity() const {
+    uint64_t available = qm.block_size - current_blocksize;
+    return available > BLOCKRESERVE ? available - BLOCKRESERVE : 0;
+  }
+  // payload alignment is only used by the uncompressed format
+  void alignData(const uint64_t data_size) {}
   void flush() {
     if(current_blocksize > 0) {
-      uint64_t zsize = cenv.compress(zblock.data(), zblock.size(), block.data(), current_blocksize, qm.compress_level);
-      writeSize4(myFile, zsize);
-      write_check(myFile, zblock.data(), zsize);
+      uint64_t zsize = compress_block(cenv, zblock.data(), zblock.size(), block.data(), current_blocksize, qm.compress_level, qm.raw_blocks);
+      write_block(zsize, block.data(), current_blocksize);
       current_blocksize = 0;
-      number_of_blocks++;
     }
   }
   void push_contiguous(const char * const data, const uint64_t len) {
     if(qm.check_hash) xenv.update(data, len);
     uint64_t current_pointer_consumed = 0;
     while(current_pointer_consumed < len) {
-      if(current_blocksize == BLOCKSIZE) {
+      if(current_blocksize == qm.block_size) {
         flush();
       }
-      if(current_blocksize == 0 && len - current_pointer_consumed >= BLOCKSIZE) {
-        uint64_t zsize = cenv.compress(zblock.data(), zblock.size(), data + current_pointer_consumed, BLOCKSIZE, qm.compress_level);
-        writeSize4(myFile, zsize);
-        write_check(myFile, zblock.data(), zsize);
-        current_pointer_consumed += BLOCKSIZE;
-        number_of_blocks++;
+      if(current_blocksize == 0 && len - current_pointer_consumed >= qm.block_size) {
+        uint64_t zsize = compress_block(cenv, zblock.data(), zblock.size(), data + current_pointer_consumed, qm.block_size, qm.compress_level, qm.raw_blocks);
+        write_block(zsize, data + current_pointer_consumed, qm.block_size);
+        current_pointer_consumed += qm.block_size;
       } else {
         uint64_t remaining_pointer_available = len - current_pointer_consumed;
-        uint64_t add_length = remaining_pointer_available < (BLOCKSIZE - current_blocksize) ? remaining_pointer_available : BLOCKSIZE-current_blocksize;
+        uint64_t add_length = remaining_pointer_available < (qm.block_size - current_blocksize) ? remaining_pointer_available : qm.block_size-current_blocksize;
         memcpy(block.data() + current_blocksize, data + current_pointer_consumed, add_length);
         current_blocksize += add_length;
         current_pointer_consumed += add_length;
@@ -73,18 +99,16 @@ struct CompressBuffer {
     if(qm.check_hash) xenv.update(data, len);
     uint64_t current_pointer_consumed = 0;
     while(current_pointer_consumed < len) {
-      if(BLOCKSIZE - current_blocksize < BLOCKRESERVE) {
+      if(qm.block_size - current_blocksize < BLOCKRESERVE) {
         flush();
       }
-      if(current_blocksize == 0 && len - current_pointer_consumed >= BLOCKSIZE) {
-        uint64_t zsize = cenv.compress(zblock.data(), zblock.size(), data + current_pointer_consumed, BLOCKSIZE, qm.compress_level);
-        writeSize4(myFile, zsize);
-        write_check(myFile, zblock.data(), zsize);
-        current_pointer_consumed += BLOCKSIZE;
-        number_of_blocks++;
+      if(current_blocksize == 0 && len - current_pointer_consumed >= qm.block_size) {
+        uint64_t zsize = compress_block(cenv, zblock.data(), zblock.size(), data + current_pointer_consumed, qm.block_size, qm.compress_level, qm.raw_blocks);
+        write_block(zsize, data + current_pointer_consumed, qm.block_size);
+        current_pointer_consumed += qm.block_size;
       } else {
         uint64_t remaining_pointer_available = len - current_pointer_consumed;
-        uint64_t add_length = remaining_pointer_available < (BLOCKSIZE - current_blocksize) ? remaining_pointer_available : BLOCKSIZE-current_blocksize;
+        uint64_t add_length = remaining_pointer_available < (qm.block_size - current_blocksize) ? remaining_pointer_available : qm.block_size-current_blocksize;
         memcpy(block.data() + current_blocksize, data + current_pointer_consumed, add_length);
         current_blocksize += add_length;
         current_pointer_consumed += add_length;
@@ -22,6 +22,10 @@
 #include "qs_serialize_common.h"
 
 // built in zstd streaming context
+// with nthreads > 1 zstd compresses with its own worker threads (ZSTD_c_nbWorkers); the output is still a single frame
+// but is not byte identical to the single-threaded output. If zstd was built without multithreading, nbWorkers is rejected
+// and compression stays single-threaded
+// the window size (ZSTD_c_windowLog) is recorded in the header, since readers have to allow windows larger than the zstd default
 template <class stream_writer>
 struct ZSTD_streamWrite {
   QsMetadata qm;
@@ -32,9 +36,15 @@ struct ZSTD_streamWrite {
   ZSTD_inBuffer zin;
   ZSTD_outBuffer zout;
   ZSTD_CStream* zcs;
-  ZSTD_streamWrite(stream_writer & mf, QsMetadata qm) : qm(qm), myFile(mf) {
+  ZSTD_streamWrite(stream_writer & mf, QsMetadata qm, const int nthreads = 1) : qm(qm), myFile(mf) {
     zcs = ZSTD_createCStream();
-    ZSTD_initCStream(zcs, qm.compress_level);
+    ZSTD_CCtx_setParameter(zcs, ZSTD_c_compressionLevel, qm.compress_level);
+    if(qm.window_log > 0) {
+      size_t ret = ZSTD_CCtx_setParameter(zcs, ZSTD_c_windowLog, qm.window_log);
+      if(ZSTD_isError(ret)) throw std::runtime_error("zstd window size is not supported");
+    }
+    if(qm.long_distance_matching) ZSTD_CCtx_setParameter(zcs, ZSTD_c_enableLongDistanceMatching, 1);
+    if(nthreads > 1) ZSTD_CCtx_setParameter(zcs, ZSTD_c_nbWorkers, nthreads);
     zout.size = ZSTD_CStreamOutSize();
     zout.pos = 0;
     zout.dst = outblock.data();
@@ -50,17 +60,18 @@ struct ZSTD_streamWrite {
     bytes_written += zin.size;
     while(zin.pos < zin.size) {
       zout.pos = 0;
-      uint64_t return_value = ZSTD_compressStream(zcs, &zout, &zin);
+      uint64_t return_value = ZSTD_compressStream2(zcs, &zout, &zin, ZSTD_e_continue);
       if(ZSTD_isError(return_value)) throw std::runtime_error("zstd stream compression error; output is likely corrupted");
       if(zout.pos > 0) write_check(myFile, reinterpret_cast<char*>(zout.dst), zout.pos);
     }
   }
   
   void flush() {
+    ZSTD_inBuffer zin_empty = {nullptr, 0, 0};
     uint64_t remain;
     do {
       zout.pos = 0;
-      remain = ZSTD_flushStream(zcs, &zout);
+      remain = ZSTD_compressStream2(zcs, &zout, &zin_empty, ZSTD_e_flush);
       if(ZSTD_isError(remain)) throw std::runtime_error("zstd stream compression error; output is likely corrupted");
       if(zout.pos > 0) myFile.write(reinterpret_cast<char*>(zout.dst), zout.pos);
     } while (remain != 0);
@@ -105,8 +116,9 @@ struct CompressBufferStream {
   QsMetadata qm;
   StreamClass & sobj;
   CountToObjectMap object_ref_hash;
+  StringRefMap string_refs; // see string_dedup_flag
+  WriteStack write_stack; // scratch space of writeObject, reused for every object written
   std::vector<uint8_t> shuffleblock = std::vector<uint8_t>(256);
-  std::vector<char> block = std::vector<char>(BLOCKSIZE);
 
   CompressBufferStream(StreamClass & so, QsMetadata qm) : qm(qm), sobj(so) {}
   inline void push_contiguous(const char * const data, uint64_t length) {
@@ -128,6 +140,20 @@ struct CompressBufferStream {
   //   sobj.push(reinterpret_cast<const char * const>(&pod1), sizeof(pod1)); 
   //   sobj.push(reinterpret_cast<const char * const>(&pod2), sizeof(pod2));
   // }
+  // the stream has no block boundaries, so small vectors can always be batched (writeSmallVectors)
+  uint64_t batch_capacity() const {
+    return UINT64_MAX;
+  }
+  // zero padding so that the next payload starts on an aligned file offset (see alignmentPadding)
+  void alignData(const uint64_t data_size) {
+    static const std::array<char, MMAP_ALIGNMENT> zeros = {};
+    uint64_t padding = alignmentPadding(qm, QS_HEADER_LENGTH + sobj.bytes_written, data_size);
+    while(padding > 0) {
+      uint64_t n = std::min<uint64_t>(padding, zeros.size());
+      sobj.push(zeros.data(), n);
+      padding -= n;
+    }
+  }
   void shuffle_push(const char * const data, const uint64_t len, const uint64_t bytesoftype) {
     if(len > MIN_SHUFFLE_ELEMENTS) {
       if(len > shuffleblock.size()) shuffleblock.resize(len);
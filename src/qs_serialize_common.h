@@ -25,6 +25,28 @@ struct CountToObjectMap {
   }
 };
 
+// string deduplication (see string_dedup_flag): every non-empty string of a character vector written in full is numbered in order,
+// a CHARSXP that was already written is written as the distance back to its number, which the reader looks up in its StringTable
+struct StringRefMap {
+  uint64_t count = 0;
+  std::unordered_map<SEXP, uint64_t> map;
+  // returns the distance back to x, or 0 if x has to be written in full
+  inline uint64_t find(SEXP x) const {
+    auto it = map.find(x);
+    if(it == map.end()) return 0;
+    uint64_t distance = count - it->second + 1;
+    return distance <= MAX_STRING_REF ? distance : 0;
+  }
+  inline void add(SEXP x) {
+    count++;
+    map[x] = count; // the latest occurrence gives the shortest distance
+  }
+  // later strings do not refer back to the strings written so far
+  inline void reset() {
+    if(!map.empty()) map.clear();
+  }
+};
+
 template <class T>
 void writeHeader_common(const qstype object_type, const uint64_t length, T * const sobj) {
   switch(object_type) {
@@ -234,6 +256,16 @@ void writeHeader_common(const qstype object_type, const uint64_t length, T * con
       sobj->push_pod_contiguous(static_cast<uint64_t>(length) );
     }
     return;
+  case qstype::CHARACTER_DICT:
+    sobj->push_pod_noncontiguous(extension_header);
+    sobj->push_pod_contiguous(character_dict_header);
+    sobj->push_pod_contiguous(static_cast<uint64_t>(length) );
+    return;
+  case qstype::CHARACTER_COLUMNAR:
+    sobj->push_pod_noncontiguous(extension_header);
+    sobj->push_pod_contiguous(character_columnar_header);
+    sobj->push_pod_contiguous(static_cast<uint64_t>(length) );
+    return;
   case qstype::NIL:
     sobj->push_pod_noncontiguous(null_header);
     return;
@@ -291,92 +323,359 @@ void writeStringHeader_common(const uint64_t length, const cetype_t ce_enc, T *
   }
 }
 
-void getAttributes(SEXP const x, std::vector<SEXP> & attrs, std::vector<SEXP> & anames) {
-  SEXP alist = ATTRIB(x);
-  while(alist != R_NilValue) {
-    anames.push_back(PRINTNAME(TAG(alist)));
-    attrs.push_back(CAR(alist));
-    alist = CDR(alist);
+template <class T>
+void writeStringRef_common(const uint64_t distance, T * const sobj) {
+  if(distance < 256) {
+    sobj->push_pod_noncontiguous(string_header_ref_8);
+    sobj->push_pod_contiguous(static_cast<uint8_t>(distance) );
+  } else if(distance < 65536) {
+    sobj->push_pod_noncontiguous(string_header_ref_16);
+    sobj->push_pod_contiguous(static_cast<uint16_t>(distance) );
+  } else {
+    sobj->push_pod_noncontiguous(string_header_ref_32);
+    sobj->push_pod_contiguous(static_cast<uint32_t>(distance) );
+  }
+}
+
+// writes a string of a character vector, as a reference if it was already written and strings are deduplicated (see StringRefMap)
+template <class T>
+void writeString(T * const sobj, SEXP const xi) {
+  if(xi == NA_STRING) {
+    sobj->push_pod_noncontiguous(string_header_NA); // header is only 1 byte, but use noncontiguous for consistency
+    return;
+  }
+  uint32_t di = LENGTH(xi);
+  if(sobj->qm.string_dedup && di > 0) {
+    uint64_t distance = sobj->string_refs.find(xi);
+    if(distance > 0) {
+      writeStringRef_common(distance, sobj);
+      return;
+    }
+    sobj->string_refs.add(xi);
+  }
+  writeStringHeader_common(di, Rf_getCharCE(xi), sobj);
+  sobj->push_contiguous(CHAR(xi), di);
+}
+
+// the buffers of CharacterDictionary are reused for the next vector, so they are pushed in pieces smaller than a block:
+// CompressBuffer_MT compresses a full block pushed at once directly from the pushed data on a worker thread
+template <class T>
+void pushScratch(T * const sobj, const char * const data, const uint64_t len) {
+  uint64_t piece = sobj->qm.block_size / 2;
+  for(uint64_t i=0; i<len; i += piece) {
+    sobj->push_contiguous(data + i, std::min<uint64_t>(piece, len - i));
+  }
+}
+
+// writeObject uses an explicit stack instead of recursion, so the nesting depth of an object is not limited by the C stack
+// A frame is pushed for an object with children or attributes, after its headers and data are written
+// The frame writes the children in order and then the attributes, the SEXPs are kept on a scratch stack shared by all frames
+// The stack is owned by the serialization context (write_stack), so its memory is reused for all objects written to a file
+struct WriteFrame {
+  uint64_t base; // start of the frame in WriteStack::objects: attribute values, attribute names, children (pairlists: car and tag pairs)
+  uint64_t flags_base; // start of the pairlist flags in WriteStack::flags
+  uint64_t attributes = 0;
+  uint64_t children = 0;
+  uint64_t next = 0; // next child, then next attribute
+  SEXP vector = R_NilValue; // the children are the elements of a list instead of being on the scratch stack
+  SEXP env = R_NilValue; // environment whose frame is written after the first child (ENCLOS)
+  bool pairlist = false;
+  bool has_flags = false;
+  bool unprotect = false; // the child is an evaluated promise, protected while it is written
+};
+
+// character vectors of at least MIN_DICT_LENGTH elements with at most one distinct string per DICT_FRACTION elements
+// are written as CHARACTER_DICT: the distinct strings in order of first occurrence, then the code of each element
+// codes take 0, 1, 2, 4, 8, 16 or 32 bits, codes of less than 8 bits are packed starting at the low bits of each byte
+static constexpr uint64_t MIN_DICT_LENGTH = 256ULL;
+static constexpr uint64_t DICT_FRACTION = 16ULL;
+
+struct CharacterDictionary {
+  std::unordered_map<SEXP, uint32_t> map;
+  std::vector<SEXP> strings;
+  std::vector<uint32_t> codes;
+  std::vector<uint8_t> packed;
+  // returns false as soon as x has too many distinct strings
+  bool build(SEXP const x, const uint64_t dl) {
+    map.clear();
+    strings.clear();
+    codes.resize(dl);
+    uint64_t max_size = std::min<uint64_t>(dl / DICT_FRACTION, UINT32_MAX);
+    const SEXP * xptr = STRING_PTR_RO(x);
+    for(uint64_t i=0; i<dl; i++) {
+      auto it = map.emplace(xptr[i], static_cast<uint32_t>(strings.size()));
+      if(it.second) {
+        if(strings.size() == max_size) return false;
+        strings.push_back(xptr[i]);
+      }
+      codes[i] = it.first->second;
+    }
+    return true;
+  }
+  uint8_t nbits() const {
+    if(strings.size() <= 1) return 0;
+    uint8_t n = 1;
+    while((1ULL << n) < strings.size()) n *= 2;
+    return n;
+  }
+  // packs the codes into bytes for nbits < 8, or into uint8/uint16 for 8 and 16 bits
+  void pack(const uint8_t nbits) {
+    uint64_t nbytes = (codes.size() * nbits + 7) / 8;
+    packed.assign(nbytes, 0);
+    switch(nbits) {
+    case 1:
+    case 2:
+    case 4:
+      for(uint64_t i=0; i<codes.size(); i++) {
+        packed[(i*nbits) >> 3] |= static_cast<uint8_t>(codes[i] << ((i*nbits) & 7));
+      }
+      break;
+    case 8:
+      for(uint64_t i=0; i<codes.size(); i++) packed[i] = static_cast<uint8_t>(codes[i]);
+      break;
+    case 16:
+      for(uint64_t i=0; i<codes.size(); i++) {
+        uint16_t c = static_cast<uint16_t>(codes[i]);
+        std::memcpy(packed.data() + 2*i, &c, 2);
+      }
+      break;
+    }
+  }
+};
+
+// the header is written by the caller
+template <class T>
+void writeCharacterDict(T * const sobj, CharacterDictionary & dict) {
+  uint8_t nbits = dict.nbits();
+  sobj->push_pod_contiguous(nbits);
+  sobj->push_pod_contiguous(static_cast<uint32_t>(dict.strings.size()));
+  for(uint64_t i=0; i<dict.strings.size(); i++) {
+    writeString(sobj, dict.strings[i]);
+  }
+  if(nbits == 32) {
+    if(sobj->qm.int_shuffle) {
+      sobj->shuffle_push(reinterpret_cast<char*>(dict.codes.data()), dict.codes.size()*4, 4);
+    } else {
+      pushScratch(sobj, reinterpret_cast<char*>(dict.codes.data()), dict.codes.size()*4);
+    }
+  } else if(nbits > 0) {
+    dict.pack(nbits);
+    if(nbits == 16 && sobj->qm.int_shuffle) {
+      sobj->shuffle_push(reinterpret_cast<char*>(dict.packed.data()), dict.packed.size(), 2);
+    } else {
+      pushScratch(sobj, reinterpret_cast<char*>(dict.packed.data()), dict.packed.size());
+    }
+  }
+}
+
+// with string_columnar, character vectors of at least MIN_COLUMNAR_LENGTH elements that are not dictionary encoded are written as CHARACTER_COLUMNAR
+// when the output is compressed: the grouped lengths compress better than a header per string and are decoded without branching
+// uncompressed output keeps the 1 byte header of short strings instead of a 4 byte length
+static constexpr uint64_t MIN_COLUMNAR_LENGTH = 64ULL;
+
+// scratch space of writeCharacterColumnar
+struct ColumnarStrings {
+  std::vector<uint32_t> lengths;
+  std::vector<uint8_t> encodings;
+};
+
+// the header is written by the caller
+// layout: the encoding shared by all strings (or COLUMNAR_MIXED_ENCODINGS), the uint32 length of every string
+// (NA_STRING_LENGTH for NA, STRING_REF_BIT | distance for a string_dedup reference), the cetype_t of every string if mixed,
+// the uint64 total number of bytes and then the bytes of all strings written in full
+template <class T>
+void writeCharacterColumnar(T * const sobj, SEXP const x, const uint64_t dl, ColumnarStrings & cs) {
+  const SEXP * xptr = STRING_PTR_RO(x);
+  cs.lengths.resize(dl);
+  cs.encodings.assign(dl, 0);
+  uint64_t blob_size = 0;
+  int common_encoding = -1;
+  bool mixed = false;
+  for(uint64_t i=0; i<dl; i++) {
+    SEXP xi = xptr[i];
+    if(xi == NA_STRING) {
+      cs.lengths[i] = NA_STRING_LENGTH;
+      continue;
+    }
+    uint32_t di = LENGTH(xi);
+    if(di == 0) {
+      cs.lengths[i] = 0;
+      continue;
+    }
+    if(sobj->qm.string_dedup) {
+      uint64_t distance = sobj->string_refs.find(xi);
+      if(distance > 0) {
+        cs.lengths[i] = STRING_REF_BIT | static_cast<uint32_t>(distance);
+        continue;
+      }
+      sobj->string_refs.add(xi);
+    }
+    cetype_t ce_enc = Rf_getCharCE(xi);
+    uint8_t enc = (ce_enc == CE_UTF8 || ce_enc == CE_LATIN1 || ce_enc == CE_BYTES) ? static_cast<uint8_t>(ce_enc) : static_cast<uint8_t>(CE_NATIVE);
+    cs.lengths[i] = di;
+    cs.encodings[i] = enc;
+    blob_size += di;
+    if(common_encoding < 0) {
+      common_encoding = enc;
+    } else if(common_encoding != enc) {
+      mixed = true;
+    }
+  }
+  sobj->push_pod_contiguous(mixed ? COLUMNAR_MIXED_ENCODINGS : static_cast<uint8_t>(common_encoding < 0 ? 0 : common_encoding));
+  if(sobj->qm.int_shuffle) {
+    sobj->shuffle_push(reinterpret_cast<char*>(cs.lengths.data()), dl*4, 4);
+  } else {
+    pushScratch(sobj, reinterpret_cast<char*>(cs.lengths.data()), dl*4);
+  }
+  if(mixed) pushScratch(sobj, reinterpret_cast<char*>(cs.encodings.data()), dl);
+  sobj->push_pod_contiguous(blob_size);
+  for(uint64_t i=0; i<dl; i++) {
+    uint32_t di = cs.lengths[i];
+    if(di != NA_STRING_LENGTH && !(di & STRING_REF_BIT) && di > 0) sobj->push_contiguous(CHAR(xptr[i]), di);
   }
 }
 
+// list elements that are short numeric, integer or logical vectors without attributes (e.g. as.list(1:1e6))
+// are encoded into WriteStack::staging and pushed at once instead of with a push per header and payload
+static constexpr uint64_t SMALL_VECTOR_BATCH_BYTES = 4096ULL;
+
+struct WriteStack {
+  std::vector<WriteFrame> frames;
+  std::vector<SEXP> objects;
+  std::vector<int> flags;
+  std::vector<char> staging; // encoded run of small vectors, see writeSmallVectors
+  CharacterDictionary dict;
+  ColumnarStrings columnar;
+  int protected_count = 0;
+  WriteStack() {
+    frames.reserve(64);
+    objects.reserve(256);
+    flags.reserve(64);
+    staging.resize(SMALL_VECTOR_BATCH_BYTES);
+  }
+  ~WriteStack() {
+    if(protected_count > 0) UNPROTECT(protected_count);
+  }
+  WriteFrame frame() const {
+    WriteFrame f;
+    f.base = objects.size();
+    f.flags_base = flags.size();
+    return f;
+  }
+  // pushes the attribute values and names of x onto the scratch stack, returns the number of attributes
+  uint64_t getAttributes(SEXP const x) {
+    uint64_t start = objects.size();
+    for(SEXP alist = ATTRIB(x); alist != R_NilValue; alist = CDR(alist)) {
+      objects.push_back(CAR(alist));
+    }
+    uint64_t n = objects.size() - start;
+    for(SEXP alist = ATTRIB(x); alist != R_NilValue; alist = CDR(alist)) {
+      objects.push_back(PRINTNAME(TAG(alist)));
+    }
+    return n;
+  }
+  // pushes the car and tag pairs and flags of a pairlist onto the scratch stack, returns the length
+  uint64_t getPairlist(SEXP xt, bool & has_flags) {
+    uint64_t n = 0;
+    has_flags = false;
+    while(xt != R_NilValue) {
+      int f = packFlags(xt);
+      if(f != 0) has_flags = true;
+      flags.push_back(f);
+      // if(get_bndcell_tag(xt)) R_expand_binding_value(xt);
+      objects.push_back(CAR(xt));
+      objects.push_back(TAG(xt));
+      xt = CDR(xt);
+      n++;
+    }
+    return n;
+  }
+  void push(const WriteFrame & f) {
+    if(f.attributes + f.children > 0 || f.env != R_NilValue) frames.push_back(f);
+  }
+  void pop() {
+    const WriteFrame & f = frames.back();
+    objects.resize(f.base);
+    flags.resize(f.flags_base);
+    if(f.unprotect) {
+      UNPROTECT(1);
+      protected_count--;
+    }
+    frames.pop_back();
+  }
+};
+
 template <class T>
-void writeAttributes(T * const sobj, const std::vector<SEXP> & attrs, const std::vector<SEXP> & anames) {
-  for(uint64_t i=0; i<anames.size(); i++) {
-    uint32_t alen = strlen(CHAR(anames[i]));
+void writeTag(T * const sobj, SEXP const tag) {
+  if(tag == R_NilValue) {
+    sobj->push_pod_noncontiguous(string_header_NA);
+  } else {
+    const char * tag_chars = (CHAR(PRINTNAME(tag)));
+    uint32_t alen = strlen(tag_chars);
     writeStringHeader_common(alen, CE_NATIVE, sobj);
-    sobj->push_contiguous(CHAR(anames[i]), alen);
-    writeObject(sobj, attrs[i]);
+    sobj->push_contiguous(tag_chars, alen);
   }
 }
 
 template <class T>
-void writeEnvFrame(T * const sobj, SEXP rho) {
+void writeEnvFrame(T * const sobj, SEXP rho, WriteStack & ws) {
   SEXP xt = FRAME(rho);
   if(TYPEOF(xt) == NILSXP) {
     writeHeader_common(qstype::NIL, 0, sobj);
   } else { // LISTSXP
-    // getAttributes(xt, attrs, anames);
-    // if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
-    std::vector<SEXP> cars;
-    std::vector<SEXP> tags;
-    std::vector<int> flags;
+    WriteFrame f = ws.frame();
+    f.pairlist = true;
     bool has_flags = false;
     while(xt != R_NilValue) {
-      int f = packFlags(xt);
-      if(f != 0) has_flags = true;
-      flags.push_back(f);
+      int flags = packFlags(xt);
+      if(flags != 0) has_flags = true;
+      ws.flags.push_back(flags);
       SEXP tag = TAG(xt);
-      tags.push_back(tag);
       if(R_BindingIsActive(tag, rho)) {
-        cars.push_back(CAR(xt));
+        ws.objects.push_back(CAR(xt));
       } else {
         // this expands immediate bindings; direct expansion is not allowed/part of API (Luke Tierney)
-        cars.push_back(Rf_findVarInFrame(rho, tag));
+        ws.objects.push_back(Rf_findVarInFrame(rho, tag));
       }
+      ws.objects.push_back(tag);
       xt = CDR(xt);
+      f.children++;
     }
+    f.has_flags = has_flags;
     if(has_flags) {
-      writeHeader_common(qstype::PAIRLIST_WF, cars.size(), sobj);
+      writeHeader_common(qstype::PAIRLIST_WF, f.children, sobj);
     } else {
-      writeHeader_common(qstype::PAIRLIST, cars.size(), sobj);
+      writeHeader_common(qstype::PAIRLIST, f.children, sobj);
     }
-    for(uint64_t i=0; i<cars.size(); i++) {
-      if(has_flags) sobj->push_pod_noncontiguous(flags[i]);
-      if(tags[i] == R_NilValue) {
-        sobj->push_pod_noncontiguous(string_header_NA);
-      } else {
-        const char * tag_chars = (CHAR(PRINTNAME(tags[i])));
-        uint32_t alen = strlen(tag_chars);
-        writeStringHeader_common(alen, CE_NATIVE, sobj);
-        sobj->push_contiguous(tag_chars, alen);
-      }
-      writeObject(sobj, cars[i]);
-    }
-    // writeAttributes(sobj, attrs, anames);
+    ws.push(f);
   }
 }
 
+// writes the headers and data of x, a frame is pushed onto ws for its children and attributes
 template <class T>
-void writeObject(T * const sobj, SEXP x) {
+void writeObjectStep(T * const sobj, SEXP x, WriteStack & ws) {
   // evaluate promises immediately
   if(!trust_promises_global) {
     if(TYPEOF(x) == PROMSXP) {
       int error_occurred = 0;
       SEXP xeval = R_tryEval(x, R_BaseEnv, &error_occurred);
       if(error_occurred) {
-        writeObject(sobj, R_NilValue);
+        writeObjectStep(sobj, R_NilValue, ws);
       } else {
         PROTECT(xeval);
-        writeObject(sobj, xeval);
-        UNPROTECT(1);
+        ws.protected_count++;
+        WriteFrame f = ws.frame();
+        ws.objects.push_back(xeval);
+        f.children = 1;
+        f.unprotect = true;
+        ws.push(f);
       }
       return;
     }
   }
 
-  std::vector<SEXP> attrs; // attribute objects and names; r-serialized, env-references and NULLs don't have attributes, so process inline
-  std::vector<SEXP> anames; // just declare attribute variables for convenience here
+  // r-serialized, env-references and NULLs don't have attributes
+  WriteFrame f = ws.frame();
   auto xtype = TYPEOF(x);
 
 #ifdef USE_ALT_REP
@@ -385,8 +684,8 @@ void writeObject(T * const sobj, SEXP x) {
     const char * classname = CHAR(PRINTNAME(CAR(info)));
     const char * pkgname = CHAR(PRINTNAME(CADR(info)));
     if((std::strcmp(classname, "__sf_vec__") == 0) && (DATAPTR_OR_NULL(x) == nullptr)) { // special case, unmaterialized SF vector
-      getAttributes(x, attrs, anames);
-      if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+      f.attributes = ws.getAttributes(x);
+      if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
       uint64_t dl = Rf_xlength(x);
       writeHeader_common(qstype::CHARACTER, dl, sobj);
       auto & ref = sf_vec_data_ref(x);
@@ -404,8 +703,10 @@ void writeObject(T * const sobj, SEXP x) {
           sobj->push_contiguous(ref[i].sdata.c_str(), ref[i].sdata.size());
           break;
         }
+        // there are no CHARSXPs to refer back to, but the strings are numbered by the reader all the same
+        if(sobj->qm.string_dedup && ref[i].encoding != cetype_t_ext::CE_NA && ref[i].sdata.size() > 0) sobj->string_refs.count++;
       }
-      writeAttributes(sobj, attrs, anames);
+      ws.push(f);
       return;
     } else if( altrep_registry.find(std::make_pair(classname, pkgname)) != altrep_registry.end() ) {
       Protect_Tracker pt = Protect_Tracker();
@@ -425,29 +726,34 @@ void writeObject(T * const sobj, SEXP x) {
     writeHeader_common(qstype::NIL, 0, sobj);
     return;
   case S4SXP: // S4SXP is really just a scaffold for attributes
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     writeHeader_common(qstype::S4, 0, sobj);
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   case STRSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
+    if(sobj->qm.string_dict && dl >= MIN_DICT_LENGTH && ws.dict.build(x, dl)) {
+      writeHeader_common(qstype::CHARACTER_DICT, dl, sobj);
+      writeCharacterDict(sobj, ws.dict);
+      ws.push(f);
+      return;
+    }
+    if(sobj->qm.string_columnar && dl >= MIN_COLUMNAR_LENGTH) {
+      writeHeader_common(qstype::CHARACTER_COLUMNAR, dl, sobj);
+      writeCharacterColumnar(sobj, x, dl, ws.columnar);
+      ws.push(f);
+      return;
+    }
     writeHeader_common(qstype::CHARACTER, dl, sobj);
     const SEXP * xptr = STRING_PTR_RO(x);
     for(uint64_t i=0; i<dl; i++) {
-      SEXP xi = xptr[i]; // STRING_ELT(x, i);
-      if(xi == NA_STRING) {
-        sobj->push_pod_noncontiguous(string_header_NA); // header is only 1 byte, but use noncontiguous for consistency
-      } else {
-        uint32_t di = LENGTH(xi);
-        writeStringHeader_common(di, Rf_getCharCE(xi), sobj);
-        sobj->push_contiguous(CHAR(xi), di);
-      }
+      writeString(sobj, xptr[i]); // STRING_ELT(x, i)
     }
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
   case SYMSXP:
@@ -461,64 +767,39 @@ void writeObject(T * const sobj, SEXP x) {
       return;
     } else {
       SEXP a = PRINTNAME(x);
-      getAttributes(x, attrs, anames);
-      if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+      f.attributes = ws.getAttributes(x);
+      if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
       writeHeader_common(qstype::SYM, 0, sobj);
       uint32_t alen = strlen(CHAR(a));
       writeStringHeader_common(alen, Rf_getCharCE(a), sobj);
       sobj->push_contiguous(CHAR(a), alen);
-      writeAttributes(sobj, attrs, anames);
+      ws.push(f);
       return;
     }
   }
   case VECSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
     writeHeader_common(qstype::LIST, dl, sobj);
-    for(uint64_t i=0; i<dl; i++) {
-      writeObject(sobj, VECTOR_ELT(x, i));
-    }
-    writeAttributes(sobj, attrs, anames);
+    f.vector = x;
+    f.children = dl;
+    ws.push(f);
     return;
   }
   case LISTSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
-    std::vector<SEXP> cars;
-    std::vector<SEXP> tags;
-    std::vector<int> flags;
-    SEXP xt = x;
-    bool has_flags = false;
-    while(xt != R_NilValue) {
-      int f = packFlags(xt);
-      if(f != 0) has_flags = true;
-      flags.push_back(f);
-      // if(get_bndcell_tag(xt)) R_expand_binding_value(xt);
-      cars.push_back(CAR(xt));
-      tags.push_back(TAG(xt));
-      xt = CDR(xt);
-    }
-    if(has_flags) {
-      writeHeader_common(qstype::PAIRLIST_WF, cars.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
+    f.pairlist = true;
+    f.children = ws.getPairlist(x, f.has_flags);
+    if(f.has_flags) {
+      writeHeader_common(qstype::PAIRLIST_WF, f.children, sobj);
     } else {
-      writeHeader_common(qstype::PAIRLIST, cars.size(), sobj);
+      writeHeader_common(qstype::PAIRLIST, f.children, sobj);
     }
-    for(uint64_t i=0; i<cars.size(); i++) {
-      if(has_flags) sobj->push_pod_noncontiguous(flags[i]);
-      if(tags[i] == R_NilValue) {
-        sobj->push_pod_noncontiguous(string_header_NA);
-      } else {
-        const char * tag_chars = (CHAR(PRINTNAME(tags[i])));
-        uint32_t alen = strlen(tag_chars);
-        writeStringHeader_common(alen, CE_NATIVE, sobj);
-        sobj->push_contiguous(tag_chars, alen);
-      }
-      writeObject(sobj, cars[i]);
-    }
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
 	case LANGSXP: // e.g. formulas
@@ -526,8 +807,8 @@ void writeObject(T * const sobj, SEXP x) {
 	case PROMSXP:
 	case DOTSXP:
     {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     if(LEVELS(x) != 0 || OBJECT(x) != 0) {
       int flags = packFlags(x);
       switch(xtype) {
@@ -560,11 +841,13 @@ void writeObject(T * const sobj, SEXP x) {
         break;
       }
     }
-    writeObject(sobj, TAG(x));
+    // TAG/CAR/CDR are just accessors to elements; not real pairlist
     // if(xtype != CLOSXP && get_bndcell_tag(x)) R_expand_binding_value(x);
-    writeObject(sobj, CAR(x));
-    writeObject(sobj, CDR(x)); // TAG/CAR/CDR are just accessors to elements; not real pairlist
-    writeAttributes(sobj, attrs, anames);
+    ws.objects.push_back(TAG(x));
+    ws.objects.push_back(CAR(x));
+    ws.objects.push_back(CDR(x));
+    f.children = 3;
+    ws.push(f);
     return;
   }
   case ENVSXP:
@@ -582,86 +865,90 @@ void writeObject(T * const sobj, SEXP x) {
       } else {
         // std::cout << (void *)x << std::endl;
         sobj->object_ref_hash.add_to_hash(x);
-        getAttributes(x, attrs, anames);
-        if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+        f.attributes = ws.getAttributes(x);
+        if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
         if(R_EnvironmentIsLocked(x)) {
           writeHeader_common(qstype::LOCKED_ENV, sobj->object_ref_hash.index, sobj);
         } else {
           writeHeader_common(qstype::UNLOCKED_ENV, sobj->object_ref_hash.index, sobj);
         }
-        writeObject(sobj, ENCLOS(x)); // parent env
-        // writeObject(sobj, FRAME(x));
-        writeEnvFrame(sobj, x);
-        writeObject(sobj, HASHTAB(x));
-        writeAttributes(sobj, attrs, anames);
+        ws.objects.push_back(ENCLOS(x)); // parent env
+        ws.objects.push_back(HASHTAB(x));
+        f.children = 2;
+        f.env = x; // FRAME(x) is written between ENCLOS and HASHTAB (writeEnvFrame)
+        ws.push(f);
       }
     }
     return;
   }
   case REALSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
     writeHeader_common(qstype::NUMERIC, dl, sobj);
+    sobj->alignData(dl*8);
     if(sobj->qm.real_shuffle) {
       sobj->shuffle_push(reinterpret_cast<char*>(REAL(x)), dl*8, 8);
     } else {
       sobj->push_contiguous(reinterpret_cast<char*>(REAL(x)), dl*8);
     }
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
   case INTSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
     writeHeader_common(qstype::INTEGER, dl, sobj);
+    sobj->alignData(dl*4);
     if(sobj->qm.int_shuffle) {
       sobj->shuffle_push(reinterpret_cast<char*>(INTEGER(x)), dl*4, 4);
     } else {
       sobj->push_contiguous(reinterpret_cast<char*>(INTEGER(x)), dl*4);
     }
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
   case LGLSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
     writeHeader_common(qstype::LOGICAL, dl, sobj);
+    sobj->alignData(dl*4);
     if(sobj->qm.lgl_shuffle) {
       sobj->shuffle_push(reinterpret_cast<char*>(LOGICAL(x)), dl*4, 4);
     } else {
       sobj->push_contiguous(reinterpret_cast<char*>(LOGICAL(x)), dl*4);
     }
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
   case RAWSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
     writeHeader_common(qstype::RAW, dl, sobj);
     sobj->push_contiguous(reinterpret_cast<char*>(RAW(x)), dl);
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
   case CPLXSXP:
   {
-    getAttributes(x, attrs, anames);
-    if(attrs.size() > 0) writeAttributeHeader_common(attrs.size(), sobj);
+    f.attributes = ws.getAttributes(x);
+    if(f.attributes > 0) writeAttributeHeader_common(f.attributes, sobj);
     uint64_t dl = Rf_xlength(x);
     writeHeader_common(qstype::COMPLEX, dl, sobj);
+    sobj->alignData(dl*16);
     if(sobj->qm.cplx_shuffle) {
       sobj->shuffle_push(reinterpret_cast<char*>(COMPLEX(x)), dl*16, 8);
     } else {
       sobj->push_contiguous(reinterpret_cast<char*>(COMPLEX(x)), dl*16);
     }
-    writeAttributes(sobj, attrs, anames);
+    ws.push(f);
     return;
   }
   default:
@@ -676,4 +963,143 @@ void writeObject(T * const sobj, SEXP x) {
   }
 }
 
+// encodes elements of f.vector starting at f.next while they are small vectors, returns the number of elements written
+// the run is limited to sobj->batch_capacity(), so that no header of the run would have started a new block
+// and the output is byte for byte the same as writing the elements with writeObjectStep
+template <class T>
+uint64_t writeSmallVectors(T * const sobj, WriteFrame & f, WriteStack & ws) {
+  uint64_t capacity = std::min<uint64_t>(sobj->batch_capacity(), SMALL_VECTOR_BATCH_BYTES);
+  char * const out = ws.staging.data();
+  uint64_t nbytes = 0;
+  uint64_t start = f.next;
+  while(f.next < f.children) {
+    SEXP x = VECTOR_ELT(f.vector, f.next);
+    if(ATTRIB(x) != R_NilValue || IS_S4_OBJECT(x)) break;
+#ifdef USE_ALT_REP
+    if(ALTREP(x)) break;
+#endif
+    auto xtype = TYPEOF(x);
+    if(xtype != REALSXP && xtype != INTSXP && xtype != LGLSXP) break;
+    uint64_t dl = Rf_xlength(x);
+    if(dl >= 32) break;
+    uint8_t header;
+    uint64_t bytesoftype;
+    bool shuffle;
+    const uint8_t * data;
+    switch(xtype) {
+    case REALSXP:
+      header = numeric_header_5;
+      bytesoftype = 8;
+      shuffle = sobj->qm.real_shuffle;
+      data = reinterpret_cast<const uint8_t *>(REAL(x));
+      break;
+    case INTSXP:
+      header = integer_header_5;
+      bytesoftype = 4;
+      shuffle = sobj->qm.int_shuffle;
+      data = reinterpret_cast<const uint8_t *>(INTEGER(x));
+      break;
+    default: // LGLSXP
+      header = logical_header_5;
+      bytesoftype = 4;
+      shuffle = sobj->qm.lgl_shuffle;
+      data = reinterpret_cast<const uint8_t *>(LOGICAL(x));
+      break;
+    }
+    uint64_t len = dl*bytesoftype;
+    if(nbytes + 1 + len > capacity) break;
+    out[nbytes] = static_cast<char>(header | static_cast<uint8_t>(dl));
+    if(shuffle && len > MIN_SHUFFLE_ELEMENTS) {
+      blosc_shuffle(data, reinterpret_cast<uint8_t *>(out + nbytes + 1), len, bytesoftype);
+    } else if(len > 0) {
+      std::memcpy(out + nbytes + 1, data, len);
+    }
+    nbytes += 1 + len;
+    f.next++;
+  }
+  if(nbytes > 0) sobj->push_contiguous(out, nbytes);
+  return f.next - start;
+}
+
+template <class T>
+void writeObject(T * const sobj, SEXP x) {
+  WriteStack & ws = sobj->write_stack;
+  writeObjectStep(sobj, x, ws);
+  while(!ws.frames.empty()) {
+    WriteFrame & f = ws.frames.back();
+    SEXP child;
+    if(f.env != R_NilValue && f.next == 1) {
+      SEXP rho = f.env;
+      f.env = R_NilValue;
+      writeEnvFrame(sobj, rho, ws);
+      continue;
+    } else if(f.next < f.children) {
+      if(f.vector != R_NilValue && writeSmallVectors(sobj, f, ws) > 0) continue;
+      uint64_t i = f.next++;
+      if(f.vector != R_NilValue) {
+        child = VECTOR_ELT(f.vector, i);
+      } else if(f.pairlist) {
+        if(f.has_flags) sobj->push_pod_noncontiguous(ws.flags[f.flags_base + i]);
+        writeTag(sobj, ws.objects[f.base + 2*f.attributes + 2*i + 1]);
+        child = ws.objects[f.base + 2*f.attributes + 2*i];
+      } else {
+        child = ws.objects[f.base + 2*f.attributes + i];
+      }
+    } else if(f.next < f.children + f.attributes) {
+      uint64_t i = f.next++ - f.children;
+      SEXP aname = ws.objects[f.base + f.attributes + i];
+      uint32_t alen = strlen(CHAR(aname));
+      writeStringHeader_common(alen, CE_NATIVE, sobj);
+      sobj->push_contiguous(CHAR(aname), alen);
+      child = ws.objects[f.base + i];
+    } else {
+      ws.pop();
+      continue;
+    }
+    writeObjectStep(sobj, child, ws); // f is invalidated if a frame is pushed
+  }
+}
+
+// top level entry point for block compressed formats: a plain list is written exactly as writeObject would,
+// but the decompressed offset of each element and of the attributes is recorded in sobj->element_index
+// so that elements can later be read without deserializing the rest of the object
+template <class T>
+void writeObjectIndexed(T * const sobj, SEXP x) {
+  bool indexable = TYPEOF(x) == VECSXP && !IS_S4_OBJECT(x);
+#ifdef USE_ALT_REP
+  if(ALTREP(x)) indexable = false;
+#endif
+  if(!indexable) {
+    writeObject(sobj, x);
+    return;
+  }
+  // the attributes are kept below the frames of the elements on the scratch stack
+  WriteStack & ws = sobj->write_stack;
+  uint64_t base = ws.objects.size();
+  uint64_t nattr = ws.getAttributes(x);
+  if(nattr > 0) writeAttributeHeader_common(nattr, sobj);
+  uint64_t dl = Rf_xlength(x);
+  writeHeader_common(qstype::LIST, dl, sobj);
+  std::vector<uint64_t> & offsets = sobj->element_index.offsets;
+  offsets.resize(dl+1);
+  // strings only refer back within an element (see StringRefMap), the numbering continues so that the elements can be read in any order
+  for(uint64_t i=0; i<dl; i++) {
+    offsets[i] = sobj->decompressed_offset();
+    sobj->string_refs.reset();
+    writeObject(sobj, VECTOR_ELT(x, i));
+  }
+  offsets[dl] = sobj->decompressed_offset();
+  sobj->string_refs.reset();
+  for(uint64_t i=0; i<nattr; i++) {
+    SEXP aname = ws.objects[base + nattr + i];
+    uint32_t alen = strlen(CHAR(aname));
+    writeStringHeader_common(alen, CE_NATIVE, sobj);
+    sobj->push_contiguous(CHAR(aname), alen);
+    writeObject(sobj, ws.objects[base + i]);
+  }
+  ws.objects.resize(base);
+  // environment references can point into other elements, so elements are not independently readable
+  if(sobj->object_ref_hash.index > 0) offsets.clear();
+}
+
 #endif